@@ -0,0 +1,80 @@
+/*#-------------------------------------------------
+#
+#     Color names table generator - build tool
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - reads color-names.csv at build time
+#   - writes color-names-table.h : packed RGB,
+#     CIELab values and names in one string pool
+#
+#  Usage: color-names-generator input.csv output.h
+#
+#-------------------------------------------------*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+#include "color-names.h"
+#include "color-spaces.h"
+
+std::string CStringLiteral(const std::string &text) // text as C string literal, with a final \0 - non-ASCII bytes as octal escapes
+{
+    std::string literal = "\"";
+    for (unsigned int i = 0; i < text.size(); i++) {
+        unsigned char c = text[i];
+        if ((c == '"') or (c == '\\')) // escape special chars
+            literal += std::string("\\") + char(c);
+        else if ((c < 32) or (c > 126)) { // not printable : 3-digit octal escape can't be merged with next char
+            char octal[5];
+            std::snprintf(octal, sizeof(octal), "\\%03o", c);
+            literal += octal;
+        }
+        else
+            literal += char(c);
+    }
+    return literal + "\\0\"";
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " input.csv output.h" << std::endl;
+        return 1;
+    }
+
+    struct_color_names color_names; // parse CSV file with the same function as the programs
+    if (!LoadColorNames(argv[1], color_names)) {
+        std::cerr << "Error: cannot read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::ofstream table(argv[2]); // generated header
+    if (!table) {
+        std::cerr << "Error: cannot write " << argv[2] << std::endl;
+        return 1;
+    }
+    table.precision(9); // 9 digits : float values are written exactly
+
+    table << "// Generated at build time from color-names.csv by color-names-generator - do not edit" << std::endl << std::endl
+          << "const int color_names_table_size = " << color_names.colors.size() << ";" << std::endl << std::endl
+          << "constexpr struct_color_name_entry color_names_table[] = { // packed RGB, CIELab, offset of name in pool" << std::endl;
+    int offset = 0; // position of name in string pool
+    for (unsigned int c = 0; c < color_names.colors.size(); c++) {
+        const struct_color_name &color = color_names.colors[c];
+        table << "    {" << ((color.R << 16) | (color.G << 8) | color.B) << ", "
+              << float(color.L) << ", " << float(color.A) << ", " << float(color.Bl) << ", " << offset << "}," << std::endl;
+        offset += color.name.size() + 1; // name + \0
+    }
+    table << "};" << std::endl << std::endl
+          << "constexpr char color_names_pool[] = // all names, separated by \\0" << std::endl;
+    for (unsigned int c = 0; c < color_names.colors.size(); c++)
+        table << "    " << CStringLiteral(color_names.colors[c].name) << std::endl;
+    table << ";" << std::endl;
+
+    table.close();
+    return table.good() ? 0 : 1;
+}
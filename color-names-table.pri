@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+#   Color names table generated at build time
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - included by GUI and headless library
+#   - color-names-generator is compiled with the
+#     same compiler, then run on color-names.csv
+#   - the table is compiled-in : no CSV parsing
+#     at launch
+#
+#-------------------------------------------------
+
+COLOR_NAMES_CSV = $$PWD/color-names.csv
+COLOR_NAMES_GENERATOR_SOURCES = $$PWD/color-names-generator.cpp $$PWD/color-names.cpp $$PWD/color-spaces.cpp $$PWD/angles.cpp
+for(source, COLOR_NAMES_GENERATOR_SOURCES): COLOR_NAMES_GENERATOR_FILES += $$shell_path($$source) # native separators
+
+win32-msvc* { # MSVC command line
+    COLOR_NAMES_GENERATOR_BUILD = $$QMAKE_CXX /nologo /O2 /EHsc /DCOLOR_NAMES_NO_TABLE /I$$shell_path($$PWD) $$COLOR_NAMES_GENERATOR_FILES /Fecolor-names-generator.exe
+    COLOR_NAMES_GENERATOR_RUN = color-names-generator.exe
+}
+else { # GCC, Clang, MinGW
+    COLOR_NAMES_GENERATOR_BUILD = $$QMAKE_CXX -O2 -std=c++11 -DCOLOR_NAMES_NO_TABLE -I$$shell_path($$PWD) $$COLOR_NAMES_GENERATOR_FILES -o color-names-generator -pthread
+    win32: COLOR_NAMES_GENERATOR_RUN = color-names-generator.exe
+    else: COLOR_NAMES_GENERATOR_RUN = ./color-names-generator
+}
+
+color_names_table.input = COLOR_NAMES_CSV
+color_names_table.output = color-names-table.h
+color_names_table.depends = $$COLOR_NAMES_GENERATOR_SOURCES
+color_names_table.commands = $$COLOR_NAMES_GENERATOR_BUILD $$escape_expand(\\n\\t)$$COLOR_NAMES_GENERATOR_RUN ${QMAKE_FILE_IN} ${QMAKE_FILE_OUT} # two make commands : no shell "&&"
+color_names_table.CONFIG += target_predeps no_link
+color_names_table.variable_out = HEADERS
+QMAKE_EXTRA_COMPILERS += color_names_table
+INCLUDEPATH += $$OUT_PWD
@@ -0,0 +1,232 @@
+/*#-------------------------------------------------
+#
+#               Color names database
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - color names table compiled in, generated
+#     from color-names.csv at build time
+#   - read color names from CSV file (override)
+#   - find nearest color name of a RGB value
+#     with a CIELab grid index
+#
+#  The index only prunes candidates : the result
+#  is the same as a CIEDE2000 search over all names
+#
+#-------------------------------------------------*/
+
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+
+#include "color-names.h"
+#include "color-spaces.h"
+#include "color-spaces-kernels.h"
+
+#ifndef COLOR_NAMES_NO_TABLE // defined when building the table generator
+#include "color-names-table.h" // generated at build time from color-names.csv
+#endif
+
+bool LoadColorNames(const std::string &filename, struct_color_names &color_names) // read color names from CSV file "R;G;B;name"
+{
+    std::string line; // line to read in text file
+    std::ifstream names; // file to read
+    names.open(filename); // read color names file
+
+    if (!names) // file not found ?
+        return false;
+
+    color_names.colors.clear(); // new database
+    size_t pos; // index for find function
+    std::string s; // used for item extraction
+    getline(names, line); // read first line (header)
+    while (getline(names, line)) { // read each line of text file: R G B name
+        struct_color_name color; // current color name
+        pos = 0; // find index at the beginning of the line
+        int pos2 = line.find(";", pos); // find first semicolon char
+        s = line.substr(pos, pos2 - pos); // extract R value
+        color.R = std::stoi(s); // R value
+        pos = pos2 + 1; // next char
+        pos2 = line.find(";", pos); // find second semicolon char
+        s = line.substr(pos, pos2 - pos); // extract G value
+        color.G = std::stoi(s); // G value
+        pos = pos2 + 1; // next char
+        pos2 = line.find(";", pos); // find third semicolon char
+        s = line.substr(pos, pos2 - pos); // extract B value
+        color.B = std::stoi(s); // B value
+        color.name = line.substr(pos2 + 1, line.length() - pos2); // color name is at the end of the line
+        RGBtoLAB((long double)(color.R) / 255.0, (long double)(color.G) / 255.0, (long double)(color.B) / 255.0, color.L, color.A, color.Bl); // CIELab values, only once
+        color_names.colors.push_back(color); // add it to database
+    }
+
+    names.close(); // close text file
+
+    IndexColorNames(color_names); // prepare database for nearest color queries
+
+    return true;
+}
+
+bool LoadBuiltinColorNames(struct_color_names &color_names) // color names from compiled-in table
+{
+#ifdef COLOR_NAMES_NO_TABLE
+    color_names.colors.clear(); // no table
+    IndexColorNames(color_names);
+    return false;
+#else
+    color_names.colors.resize(color_names_table_size); // new database
+    for (int c = 0; c < color_names_table_size; c++) {
+        struct_color_name &color = color_names.colors[c];
+        color.R = (color_names_table[c].RGB >> 16) & 255; // unpack RGB values
+        color.G = (color_names_table[c].RGB >> 8) & 255;
+        color.B = color_names_table[c].RGB & 255;
+        color.L = color_names_table[c].L; // CIELab values computed at build time
+        color.A = color_names_table[c].A;
+        color.Bl = color_names_table[c].B;
+        color.name = color_names_pool + color_names_table[c].name; // name from string pool
+    }
+
+    IndexColorNames(color_names); // prepare database for nearest color queries
+
+    return true;
+#endif
+}
+
+//// Nearest color name
+//// CIEDE2000 distance with weights (1, 0.5, 1) is not an euclidian distance, but it has a lower bound from the
+//// differences of L and of the (a,b) plane distance, with Cq the query chroma (all values in CIEDE2000 units, i.e. [0..1] * 100) :
+////   dE00^2 >= dL^2 / S_L^2 + (1 - |R_T| / 2) * dab^2 / max(k_C * S_C, S_H)^2
+////   with S_L <= 1.75, |R_T| <= 2 * sin(60°), and max(k_C * S_C, S_H) <= 1 + 0.03 * (1.5 * Cq + 0.75 * dab)
+//// Grid cells and colors whose bound exceeds the best distance found so far can't contain the nearest color
+
+const float color_names_cell = 8; // size of grid cell in CIEDE2000 units
+
+long double ColorNameLowerBound(const long double &dL, const long double &dab, const long double &Cq) // lower bound of CIEDE2000 (1, 0.5, 1) distance
+{
+    const long double SL = 1.75; // maximum of S_L for L in [0..100]
+    const long double D = 1.0 + 0.03 * (1.5 * Cq + 0.75 * dab); // maximum of k_C * S_C and S_H
+    return sqrtl(dL * dL / (SL * SL) + 0.13 * dab * dab / (D * D)); // 0.13 < 1 - sin(60°)
+}
+
+void IndexColorNames(struct_color_names &color_names) // compute grid index of color names
+{
+    color_names.exact.clear();
+    color_names.cell_start.clear();
+    color_names.cell_colors.clear();
+    if (color_names.colors.empty()) // no database !
+        return;
+
+    float maximum[3]; // bounding box of colors in CIEDE2000 units
+    for (int i = 0; i < 3; i++) {
+        color_names.grid_min[i] = 1000000;
+        maximum[i] = -1000000;
+    }
+    for (unsigned int c = 0; c < color_names.colors.size(); c++) {
+        const struct_color_name &color = color_names.colors[c];
+        color_names.exact.insert(std::make_pair((color.R << 16) | (color.G << 8) | color.B, int(c))); // first color with these RGB values is kept
+        const float values[3] = {float(color.L * 100.0), float(color.A * 100.0), float(color.Bl * 100.0)};
+        for (int i = 0; i < 3; i++) {
+            color_names.grid_min[i] = std::min(color_names.grid_min[i], values[i]);
+            maximum[i] = std::max(maximum[i], values[i]);
+        }
+    }
+    for (int i = 0; i < 3; i++)
+        color_names.grid_size[i] = int((maximum[i] - color_names.grid_min[i]) / color_names_cell) + 1; // number of cells
+
+    std::vector<int> cell(color_names.colors.size()); // cell of each color
+    color_names.cell_start.assign(color_names.grid_size[0] * color_names.grid_size[1] * color_names.grid_size[2] + 1, 0);
+    for (unsigned int c = 0; c < color_names.colors.size(); c++) {
+        const struct_color_name &color = color_names.colors[c];
+        int gL = std::min(int((color.L * 100.0 - color_names.grid_min[0]) / color_names_cell), color_names.grid_size[0] - 1); // cell coordinates
+        int ga = std::min(int((color.A * 100.0 - color_names.grid_min[1]) / color_names_cell), color_names.grid_size[1] - 1);
+        int gb = std::min(int((color.Bl * 100.0 - color_names.grid_min[2]) / color_names_cell), color_names.grid_size[2] - 1);
+        cell[c] = (std::max(gL, 0) * color_names.grid_size[1] + std::max(ga, 0)) * color_names.grid_size[2] + std::max(gb, 0);
+        color_names.cell_start[cell[c] + 1]++; // count colors in cell
+    }
+    for (unsigned int g = 1; g < color_names.cell_start.size(); g++) // cumulative counts = start of each cell
+        color_names.cell_start[g] += color_names.cell_start[g - 1];
+    color_names.cell_colors.resize(color_names.colors.size());
+    std::vector<int> position(color_names.cell_start.begin(), color_names.cell_start.end() - 1); // next free position in each cell
+    for (unsigned int c = 0; c < color_names.colors.size(); c++) // colors stay sorted by index in each cell
+        color_names.cell_colors[position[cell[c]]++] = c;
+}
+
+std::string NearestColorName(const struct_color_names &color_names, const int &R, const int &G, const int &B) // find color name of RGB value, or nearest one with CIEDE2000 distance
+{
+    if (color_names.colors.empty()) // no database !
+        return "";
+
+    std::unordered_map<int, int>::const_iterator found = color_names.exact.find((R << 16) | (G << 8) | B); // same RGB values in database ?
+    if (found != color_names.exact.end())
+        return color_names.colors[found->second].name; // exact color found in color names database
+
+    long double L, A, Bl; // CIELab values of query
+    RGBtoLAB((long double)(R) / 255.0, (long double)(G) / 255.0, (long double)(B) / 255.0, L, A, Bl);
+    const long double q[3] = {L * 100.0, A * 100.0, Bl * 100.0}; // in CIEDE2000 units
+    const long double Cq = sqrtl(q[1] * q[1] + q[2] * q[2]); // chroma of query
+
+    int center[3]; // cell of query, clamped to grid
+    int max_ring = 0; // rings needed to cover the whole grid
+    for (int i = 0; i < 3; i++) {
+        center[i] = std::max(0, std::min(color_names.grid_size[i] - 1, int(floorl((q[i] - color_names.grid_min[i]) / color_names_cell))));
+        max_ring = std::max(max_ring, std::max(center[i], color_names.grid_size[i] - 1 - center[i]));
+    }
+
+    double distance = 1000000; // distance from nearest color - fast double precision search
+    std::vector<std::pair<double, int>> candidates; // colors that could be the nearest one
+
+    for (int ring = 0; ring <= max_ring; ring++) { // cells at Chebyshev distance ring from query cell
+        if (ring > 1) { // any color in this ring or beyond is at least (ring - 1) cells away on one axis
+            const long double gap = (ring - 1) * color_names_cell;
+            if (std::min(ColorNameLowerBound(gap, 0, Cq), ColorNameLowerBound(0, gap, Cq)) > distance) // nothing nearer can be found
+                break;
+        }
+        for (int gL = std::max(0, center[0] - ring); gL <= std::min(color_names.grid_size[0] - 1, center[0] + ring); gL++)
+            for (int ga = std::max(0, center[1] - ring); ga <= std::min(color_names.grid_size[1] - 1, center[1] + ring); ga++)
+                for (int gb = std::max(0, center[2] - ring); gb <= std::min(color_names.grid_size[2] - 1, center[2] + ring); gb++) {
+                    if (std::max(std::max(abs(gL - center[0]), abs(ga - center[1])), abs(gb - center[2])) != ring) // only cells of this ring
+                        continue;
+                    const int cell = (gL * color_names.grid_size[1] + ga) * color_names.grid_size[2] + gb;
+                    if (color_names.cell_start[cell] == color_names.cell_start[cell + 1]) // empty cell
+                        continue;
+
+                    long double gap[3]; // distance from query to cell box on each axis
+                    const int coordinates[3] = {gL, ga, gb};
+                    for (int a = 0; a < 3; a++) {
+                        const long double low = color_names.grid_min[a] + coordinates[a] * color_names_cell;
+                        gap[a] = std::max((long double)(0), std::max(low - q[a], q[a] - low - color_names_cell));
+                    }
+                    if (ColorNameLowerBound(gap[0], sqrtl(gap[1] * gap[1] + gap[2] * gap[2]), Cq) > distance) // no color in this cell can be nearer
+                        continue;
+
+                    for (int i = color_names.cell_start[cell]; i < color_names.cell_start[cell + 1]; i++) { // colors in cell
+                        const int c = color_names.cell_colors[i];
+                        const struct_color_name &color = color_names.colors[c];
+                        const long double dL = color.L * 100.0 - q[0]; // cheap euclidian bound first
+                        const long double da = color.A * 100.0 - q[1];
+                        const long double db = color.Bl * 100.0 - q[2];
+                        if (ColorNameLowerBound(fabsl(dL), sqrtl(da * da + db * db), Cq) > distance) // can't be nearer
+                            continue;
+                        double d = CIEDE2000Kernel(double(L), double(A), double(Bl), double(color.L), double(color.A), double(color.Bl), 1.0, 0.5, 1.0); // CIEDE2000 distance with emphasis on Lightness
+                        candidates.push_back(std::make_pair(d, c));
+                        distance = std::min(distance, d);
+                    }
+                }
+    }
+
+    // the double precision distance is very near the reference : the reference decides between the best candidates
+    long double best = 1000000; // reference distance from nearest color
+    int index = -1; // to keep nearest color index in color names table
+    for (unsigned int i = 0; i < candidates.size(); i++)
+        if (candidates[i].first <= distance + 1e-6) { // one of the nearest colors
+            const struct_color_name &color = color_names.colors[candidates[i].second];
+            long double d = distanceCIEDE2000LAB(L, A, Bl, color.L, color.A, color.Bl, 1.0, 0.5, 1.0); // reference CIEDE2000 distance
+            if ((d < best) or ((d == best) and (candidates[i].second < index))) { // nearer, or same distance and first in table
+                best = d;
+                index = candidates[i].second;
+            }
+        }
+
+    return color_names.colors[index].name; // exact color not found so return nearest color name
+}
@@ -0,0 +1,52 @@
+/*#-------------------------------------------------
+#
+#               Color names database
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - color names table compiled in, generated
+#     from color-names.csv at build time
+#   - read color names from CSV file (override)
+#   - find nearest color name of a RGB value
+#     with a CIELab grid index
+#
+#-------------------------------------------------*/
+
+#ifndef COLORNAMES_H
+#define COLORNAMES_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+struct struct_color_name { // structure of color name
+    int R; // RGB values in [0..255]
+    int G;
+    int B;
+    std::string name; // color name
+    long double L, A, Bl; // CIELab values in [0..1], computed once
+};
+
+struct struct_color_name_entry { // compiled-in color name - see color-names-generator
+    int RGB; // (R << 16 | G << 8 | B)
+    float L, A, B; // CIELab values in [0..1]
+    int name; // offset of name in string pool
+};
+
+struct struct_color_names { // color names database with its index
+    std::vector<struct_color_name> colors; // all color names
+    std::unordered_map<int, int> exact; // (R << 16 | G << 8 | B) -> index of first color with these RGB values
+    float grid_min[3]; // uniform grid over CIELab (CIEDE2000 units) : origin
+    int grid_size[3]; // number of cells for L, a and b
+    std::vector<int> cell_start; // colors of cell c are cell_colors[cell_start[c]..cell_start[c + 1][
+    std::vector<int> cell_colors; // color indexes sorted by cell, then by index
+};
+
+bool LoadColorNames(const std::string &filename, struct_color_names &color_names); // read color names from CSV file "R;G;B;name" - returns false if file not found
+bool LoadBuiltinColorNames(struct_color_names &color_names); // color names from compiled-in table - returns false if there is no table
+void IndexColorNames(struct_color_names &color_names); // compute grid index of color names - CIELab values must be known
+std::string NearestColorName(const struct_color_names &color_names, const int &R, const int &G, const int &B); // find color name of RGB value, or nearest one with CIEDE2000 distance
+
+#endif // COLORNAMES_H
@@ -0,0 +1,217 @@
+/*#-------------------------------------------------
+#
+#     Color spaces conversions - scalar kernels
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#  Scalar templated versions (float, double, long
+#  double) of the most used conversions of
+#  color-spaces.h :
+#    - gamma correction to and from sRGB
+#    - RGB to CIE XYZ
+#    - CIE XYZ to CIE L*a*b*
+#    - CIE L*a*b* to CIE LCHab
+#    - RGB to HSL
+#    - CIEDE2000 distance
+#
+#  RGB to CIELab row versions : plain scalar loops
+#  over one row of each channel, in double instead
+#  of long double - used by ImgRGBtoLab when the
+#  lookup cube is disabled. No SIMD
+#
+#  The long double functions of color-spaces.h are
+#  the reference : same formulas, same constants
+#
+#-------------------------------------------------*/
+
+#ifndef COLORSPACESKERNELS_H
+#define COLORSPACESKERNELS_H
+
+#include <cmath>
+#include <algorithm>
+
+//// Single values
+
+template <typename T>
+inline T GammaToLinearKernel(const T &value) // gamma correction from sRGB value to linear value - see GammaCorrectionToSRGB
+{
+    return (value > T(0.04045)) ? std::pow((value + T(0.055)) / T(1.055), T(2.4)) : value / T(12.92);
+}
+
+template <typename T>
+inline T GammaFromLinearKernel(const T &value) // gamma correction from linear value to sRGB value - see GammaCorrectionFromSRGB
+{
+    return (value > T(0.0031308)) ? T(1.055) * std::pow(value, T(1.0) / T(2.4)) - T(0.055) : value * T(12.92);
+}
+
+template <typename T>
+inline void GammaCorrectionToSRGBKernel(const T &R, const T &G, const T &B, T &r, T &g, T &b) // apply linear RGB gamma correction to sRGB - see GammaCorrectionToSRGB
+{
+    r = GammaToLinearKernel(R);
+    g = GammaToLinearKernel(G);
+    b = GammaToLinearKernel(B);
+}
+
+template <typename T>
+inline void GammaCorrectionFromSRGBKernel(const T &R, const T &G, const T &B, T &r, T &g, T &b) // apply linear gamma correction from sRGB - see GammaCorrectionFromSRGB
+{
+    r = GammaFromLinearKernel(R);
+    g = GammaFromLinearKernel(G);
+    b = GammaFromLinearKernel(B);
+}
+
+template <typename T>
+inline void RGBtoXYZKernel(const T &R, const T &G, const T &B, T &X, T &Y, T &Z) // convert RGB (in fact sRGB) value to CIE XYZ - see RGBtoXYZ
+{
+    T r = GammaToLinearKernel(R); // gamma correction to linear sRGB
+    T g = GammaToLinearKernel(G);
+    T b = GammaToLinearKernel(B);
+
+    X = r * T(0.4124564) + g * T(0.3575761) + b * T(0.1804375); // gammut conversion to sRGB
+    Y = r * T(0.2126729) + g * T(0.7151522) + b * T(0.0721750);
+    Z = r * T(0.0193339) + g * T(0.1191920) + b * T(0.9503041);
+}
+
+template <typename T>
+inline T LabFunctionKernel(const T &value) // CIELab f(t) function
+{
+    const T E = T(216.0) / T(24389.0); // CIE values
+    const T K = T(24389.0) / T(27.0);
+    return (value > E) ? std::cbrt(value) : (K * value + T(16.0)) / T(116.0);
+}
+
+template <typename T>
+inline void XYZtoLABKernel(const T &X, const T &Y, const T &Z, T &L, T &A, T &B) // convert CIE XYZ value to CIE L*a*b* in [0..1] - see XYZtoLAB
+{
+    T fX = LabFunctionKernel(X / T(0.95047)); // divided by reference white
+    T fY = LabFunctionKernel(Y / T(1.0));
+    T fZ = LabFunctionKernel(Z / T(1.08883));
+
+    L = (T(116.0) * fY - T(16.0)) / T(100.0); // to stay in [0..1] range
+    A = (T(500.0) * (fX - fY)) / T(127.0);
+    B = (T(200.0) * (fY - fZ)) / T(127.0);
+}
+
+template <typename T>
+inline void LABtoLCHabKernel(const T &A, const T &B, T &C, T &H) // convert from LAB to LCHab - see LABtoLCHab
+{
+    const T pi = T(3.14159265358979323846264338328L);
+
+    C = std::sqrt(A * A + B * B); // chroma
+
+    H = std::atan2(B, A) / T(2.0) / pi; // hue - cartesian to polar in [-0.5..0.5]
+    H = (H < T(0)) ? H + T(1.0) : H; // hue in range [0..1]
+}
+
+template <typename T>
+inline void RGBtoHSLKernel(const T &R, const T &G, const T &B, T &H, T &S, T &L, T &C) // convert RGB value to HSL - see RGBtoHSL
+{
+    T cmax = std::max(std::max(R, G), B); // maximum of RGB
+    T cmin = std::min(std::min(R, G), B); // minimum of RGB
+    T diff = cmax - cmin; // diff of cmax and cmin
+    T safe = (diff == T(0)) ? T(1) : diff; // avoid division by 0 for grays
+
+    L = (cmax + cmin) / T(2.0); // middle of range
+
+    T s_low = diff / ((cmax + cmin == T(0)) ? T(1) : cmax + cmin); // S depends on Lightness
+    T s_high = diff / ((cmax + cmin == T(2)) ? T(1) : T(2.0) - cmax - cmin);
+    S = (diff == T(0)) ? T(0) : ((L < T(0.5)) ? s_low : s_high);
+
+    // which is the dominant in R, G, B - same priority as reference : blue, then green, then red
+    T h = (cmax == B) ? T(4.0) + (R - G) / safe : ((cmax == G) ? T(2.0) + (B - R) / safe : (G - B) / safe);
+    h = (diff == T(0)) ? T(0) : h * T(60.0); // H in degrees - gray has no hue
+    h = (h < T(0)) ? h + T(360.0) : h; // H in [0..360[
+    h = (h >= T(360.0)) ? h - T(360.0) : h;
+
+    H = h / T(360.0); // final results in range [0..1]
+    C = diff; // chroma
+}
+
+template <typename T>
+inline T CIEDE2000Kernel(const T &L1, const T &A1, const T &B1, const T &L2, const T &A2, const T &B2,
+                         const T &k_L, const T &k_C, const T &k_H) // CIEDE2000 distance between 2 CIELab [0..1] values - see distanceCIEDE2000LAB
+{
+    const T pi = T(3.14159265358979323846264338328L);
+    const T deg = pi / T(180.0); // degrees to radians
+    const T pow25_7 = T(6103515625.0); // 25^7
+
+    const T l1 = L1 * T(100.0); // L, a and b in [0..100]
+    const T l2 = L2 * T(100.0);
+    const T a1 = A1 * T(100.0);
+    const T a2 = A2 * T(100.0);
+    const T b1 = B1 * T(100.0);
+    const T b2 = B2 * T(100.0);
+
+    // step 1 : C' and h'
+    T barC = (std::sqrt(a1 * a1 + b1 * b1) + std::sqrt(a2 * a2 + b2 * b2)) / T(2.0); // chromas mean
+    T barC7 = std::pow(barC, T(7.0));
+    T G = T(0.5) * (T(1.0) - std::sqrt(barC7 / (barC7 + pow25_7)));
+    T a1Prime = (T(1.0) + G) * a1;
+    T a2Prime = (T(1.0) + G) * a2;
+    T CPrime1 = std::sqrt(a1Prime * a1Prime + b1 * b1);
+    T CPrime2 = std::sqrt(a2Prime * a2Prime + b2 * b2);
+    T hPrime1 = ((b1 == T(0)) and (a1Prime == T(0))) ? T(0) : std::atan2(b1, a1Prime);
+    hPrime1 = ((hPrime1 < T(0)) ? hPrime1 + T(2.0) * pi : hPrime1) / deg; // in degrees
+    T hPrime2 = ((b2 == T(0)) and (a2Prime == T(0))) ? T(0) : std::atan2(b2, a2Prime);
+    hPrime2 = ((hPrime2 < T(0)) ? hPrime2 + T(2.0) * pi : hPrime2) / deg;
+
+    // step 2 : deltas
+    T deltaLPrime = l2 - l1;
+    T deltaCPrime = CPrime2 - CPrime1;
+    T CPrimeProduct = CPrime1 * CPrime2;
+    T deltahPrime = hPrime2 - hPrime1;
+    deltahPrime = (deltahPrime < T(-180.0)) ? deltahPrime + T(360.0) : ((deltahPrime > T(180.0)) ? deltahPrime - T(360.0) : deltahPrime);
+    deltahPrime = (CPrimeProduct == T(0)) ? T(0) : deltahPrime;
+    T deltaHPrime = T(2.0) * std::sqrt(CPrimeProduct) * std::sin(deltahPrime * deg / T(2.0));
+
+    // step 3 : weighting functions
+    T barLPrime = (l1 + l2) / T(2.0);
+    T barCPrime = (CPrime1 + CPrime2) / T(2.0);
+    T hPrimeSum = hPrime1 + hPrime2;
+    T barhPrime;
+    if (CPrimeProduct == T(0))
+        barhPrime = hPrimeSum;
+    else if (std::abs(hPrime1 - hPrime2) <= T(180.0))
+        barhPrime = hPrimeSum / T(2.0);
+    else
+        barhPrime = (hPrimeSum < T(360.0)) ? (hPrimeSum + T(360.0)) / T(2.0) : (hPrimeSum - T(360.0)) / T(2.0);
+    T h = barhPrime * deg;
+    T Tw = T(1.0) - T(0.17) * std::cos(h - T(30.0) * deg) + T(0.24) * std::cos(T(2.0) * h)
+           + T(0.32) * std::cos(T(3.0) * h + T(6.0) * deg) - T(0.20) * std::cos(T(4.0) * h - T(63.0) * deg);
+    T theta = (h - T(275.0) * deg) / (T(25.0) * deg);
+    T deltaTheta = T(30.0) * deg * std::exp(-theta * theta);
+    T barCPrime7 = std::pow(barCPrime, T(7.0));
+    T R_C = T(2.0) * std::sqrt(barCPrime7 / (barCPrime7 + pow25_7));
+    T L50 = (barLPrime - T(50.0)) * (barLPrime - T(50.0));
+    T S_L = T(1.0) + (T(0.015) * L50) / std::sqrt(T(20.0) + L50);
+    T S_C = T(1.0) + T(0.045) * barCPrime;
+    T S_H = T(1.0) + T(0.015) * barCPrime * Tw;
+    T R_T = -std::sin(T(2.0) * deltaTheta) * R_C;
+
+    // delta E
+    T dL = deltaLPrime / (k_L * S_L);
+    T dC = deltaCPrime / (k_C * S_C);
+    T dH = deltaHPrime / (k_H * S_H);
+    return std::sqrt(dL * dL + dC * dC + dH * dH + R_T * dC * dH);
+}
+
+//// Rows of values - one array per channel, count values
+//// Pointers must not overlap
+
+template <typename T>
+void RGBtoXYZRow(const T *R, const T *G, const T *B, T *X, T *Y, T *Z, const int &count) // convert count RGB values to CIE XYZ
+{
+    for (int i = 0; i < count; i++)
+        RGBtoXYZKernel(R[i], G[i], B[i], X[i], Y[i], Z[i]);
+}
+
+template <typename T>
+void XYZtoLABRow(const T *X, const T *Y, const T *Z, T *L, T *A, T *B, const int &count) // convert count CIE XYZ values to CIE L*a*b*
+{
+    for (int i = 0; i < count; i++)
+        XYZtoLABKernel(X[i], Y[i], Z[i], L[i], A[i], B[i]);
+}
+
+#endif // COLORSPACESKERNELS_H
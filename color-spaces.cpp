@@ -20,13 +20,18 @@
 #    - CMYK
 #
 #  + color utils
+#  + RGB to CIELab lookup cube
 #
 #-------------------------------------------------*/
 
 #include <algorithm>
 #include <math.h>
+#include <vector>
+#include <mutex>
+#include <thread>
 
 #include "color-spaces.h"
+#include "color-spaces-kernels.h"
 #include "angles.h"
 
 /////////////////// Distances //////////////////////
@@ -169,25 +174,22 @@ long double distanceCIEDE2000LAB(const long double &L1, const long double &A1, c
 
 long double DistanceFromBlackRGB(const long double &R, const long double &G, const long double &B) // CIEDE2000 distance from RGB(0,0,0)
 {
-    long double X, Y, Z, L, a, b;
-    RGBtoXYZ(R, G, B, X, Y, Z); // convert RGB to XYZ
-    XYZtoLAB(X, Y, Z, L, a, b); // convert XYZ to CIELab
+    long double L, a, b;
+    RGBtoLAB(R, G, B, L, a, b); // convert RGB to CIELab
     return distanceCIEDE2000LAB(L, a, b, 0, 0, 0, 1.0, 1.0, 1.0); // CIEDE2000 distance from pure black
 }
 
 long double DistanceFromWhiteRGB(const long double &R, const long double &G, const long double &B) // CIEDE2000 distance from RGB(1,1,1)
 {
-    long double X, Y, Z, L, a, b;
-    RGBtoXYZ(R, G, B, X, Y, Z); // convert RGB to XYZ
-    XYZtoLAB(X, Y, Z, L, a, b); // convert XYZ to CIELab
+    long double L, a, b;
+    RGBtoLAB(R, G, B, L, a, b); // convert RGB to CIELab
     return distanceCIEDE2000LAB(L, a, b, 1, 0, 0, 1.0, 1.0, 1.0); // CIEDE2000 distance from white
 }
 
 long double DistanceFromGrayRGB(const long double &R, const long double &G, const long double &B) // CIEDE2000 distance from nearest gray (computed in CIELAB)
 {
-    long double X, Y, Z, L, a, b;
-    RGBtoXYZ(R, G, B, X, Y, Z); // convert RGB to XYZ
-    XYZtoLAB(X, Y, Z, L, a, b); // convert XYZ to CIELab
+    long double L, a, b;
+    RGBtoLAB(R, G, B, L, a, b); // convert RGB to CIELab
     return distanceCIEDE2000LAB(L, a, b, L, 0, 0, 1.0, 1.0, 1.0); // CIEDE2000 distance from corresponding gray (same L value with a=b=0, i.e. no chroma)
 }
 
@@ -195,11 +197,9 @@ long double DistanceRGB(const long double &R1, const long double &G1, const long
                         const long double &R2, const long double &G2, const long double &B2,
                         const long double k_L, const long double k_C, const long double k_H) // CIEDE2000 distance between 2 RGB values
 {
-    long double X, Y, Z, L1, a1, b1, L2, a2, b2;
-    RGBtoXYZ(R1, G1, B1, X, Y, Z); // convert RGB to XYZ
-    XYZtoLAB(X, Y, Z, L1, a1, b1); // convert XYZ to CIELab
-    RGBtoXYZ(R2, G2, B2, X, Y, Z); // same for 2nd RGB value
-    XYZtoLAB(X, Y, Z, L2, a2, b2);
+    long double L1, a1, b1, L2, a2, b2;
+    RGBtoLAB(R1, G1, B1, L1, a1, b1); // convert RGB to CIELab
+    RGBtoLAB(R2, G2, B2, L2, a2, b2); // same for 2nd RGB value
     return distanceCIEDE2000LAB(L1, a1, b1, L2, a2, b2, k_L, k_C, k_H); // CIEDE2000 distance
 }
 
@@ -278,11 +278,9 @@ void HSLChfromRGB(const long double &R, const long double &G, const long double
 {
     // C, L and S from LCHab are more perceptive than S and L from HSL that is derived from RGB
 
-    long double X, Y, Z; // for XYZ values
     long double a, b; // for CIELab and CIELCHab
 
-    RGBtoXYZ(R, G, B, X, Y, Z); // first step to get values in CIE spaces : convert RGB to XYZ
-    XYZtoLAB(X, Y, Z, L, a, b); // then to CIELAb
+    RGBtoLAB(R, G, B, L, a, b); // first step to get values in CIE spaces : convert RGB to CIELab (cube lookup if possible)
     LABtoLCHab(a, b, C, h); // then to CIELCHab
 
     if (L == 0) { // black is a particular value
@@ -783,6 +781,169 @@ void LABtoStandard(const long double &l, const long double &a, const long double
     B = round(b * 127.0L);
 }
 
+//// RGB to CIELab lookup cube
+//// All 256^3 8-bit RGB values converted once to CIELab, stored as float : 16M * 3 * 4 bytes = 192 MB
+//// Built on first use, in parallel, then shared by all RGB to CIELab conversions
+//// Values are the same as RGBtoXYZ + XYZtoLAB, rounded to float
+
+static bool RGBtoLabCubeEnabled = true; // use the cube or compute each value
+static std::vector<float> RGBtoLabCubeValues; // the cube : index = (R << 16 | G << 8 | B) * 3 -> L, a, b
+static std::once_flag RGBtoLabCubeBuilt; // build it only once, even with several threads asking
+
+void BuildRGBtoLabCubeSlice(const int &R_begin, const int &R_end, const long double *linear) // compute CIELab values for R in [R_begin..R_end[
+{ // same formulas as RGBtoXYZ and XYZtoLAB, in double precision because values are stored as float
+    double X, Y, Z, L, a, b;
+    for (int R = R_begin; R < R_end; R++)
+        for (int G = 0; G < 256; G++)
+            for (int B = 0; B < 256; B++) {
+                double r = linear[R]; // gamma correction to linear sRGB already done
+                double g = linear[G];
+                double bl = linear[B];
+                X = r * 0.4124564 + g * 0.3575761 + bl * 0.1804375; // gammut conversion to sRGB
+                Y = r * 0.2126729 + g * 0.7151522 + bl * 0.0721750;
+                Z = r * 0.0193339 + g * 0.1191920 + bl * 0.9503041;
+                XYZtoLABKernel(X, Y, Z, L, a, b); // convert XYZ to CIELab
+                size_t index = size_t((R << 16) | (G << 8) | B) * 3; // position in cube
+                RGBtoLabCubeValues[index] = float(L);
+                RGBtoLabCubeValues[index + 1] = float(a);
+                RGBtoLabCubeValues[index + 2] = float(b);
+            }
+}
+
+void BuildRGBtoLabCube() // compute all cube values, R planes are shared between threads
+{
+    RGBtoLabCubeValues.resize(size_t(256 * 256 * 256) * 3); // 8-bit RGB values * 3 CIELab values
+
+    long double linear[256]; // gamma correction is computed only once for each 8-bit value
+    for (int v = 0; v < 256; v++) {
+        long double value = (long double)v / 255.0;
+        GammaCorrectionToSRGB(value, value, value, linear[v], linear[v], linear[v]);
+    }
+
+    int nb_threads = std::max(1, std::min(int(std::thread::hardware_concurrency()), 256)); // number of threads
+    std::vector<std::thread> threads; // workers
+    for (int t = 0; t < nb_threads; t++) // each thread has its own R planes
+        threads.push_back(std::thread(BuildRGBtoLabCubeSlice, 256 * t / nb_threads, 256 * (t + 1) / nb_threads, linear));
+    for (unsigned int t = 0; t < threads.size(); t++) // wait for all of them
+        threads[t].join();
+}
+
+void EnableRGBtoLabCube(const bool &enable) // use (or not) the RGB to CIELab lookup cube - the cube is built on first use
+{
+    RGBtoLabCubeEnabled = enable;
+}
+
+bool IsRGBtoLabCubeEnabled() // is RGB to CIELab lookup cube used ?
+{
+    return RGBtoLabCubeEnabled;
+}
+
+const float* RGBtoLabCube() // pointer to RGB to CIELab lookup cube, built if needed - index = (R << 16 | G << 8 | B) * 3 -> L, a, b
+{
+    std::call_once(RGBtoLabCubeBuilt, BuildRGBtoLabCube); // build it once
+    return RGBtoLabCubeValues.data();
+}
+
+void RGBtoLABCube(const int &R, const int &G, const int &B, long double &L, long double &A, long double &Bl) // 8-bit RGB [0..255] to CIELab [0..1] with lookup cube
+{
+    const float *lab = RGBtoLabCube() + size_t((R << 16) | (G << 8) | B) * 3; // values in cube
+    L = lab[0];
+    A = lab[1];
+    Bl = lab[2];
+}
+
+bool IsRGB8bit(const long double &value, int &value_8bit) // is a [0..1] value an exact 8-bit value ?
+{
+    long double v = value * 255.0L; // [0..255] value
+    value_8bit = round(v); // nearest 8-bit value
+    return ((value_8bit >= 0) and (value_8bit <= 255) and (fabsl(v - value_8bit) < 1e-9L)); // exact if near enough
+}
+
+void RGBtoLAB(const long double &R, const long double &G, const long double &B, long double &L, long double &A, long double &Bl) // convert RGB value to CIELab - uses lookup cube for 8-bit values
+{
+    int r, g, b; // 8-bit values
+    if ((RGBtoLabCubeEnabled) and (IsRGB8bit(R, r)) and (IsRGB8bit(G, g)) and (IsRGB8bit(B, b))) { // use cube ?
+        RGBtoLABCube(r, g, b, L, A, Bl);
+        return;
+    }
+
+    long double X, Y, Z; // compute values
+    RGBtoXYZ(R, G, B, X, Y, Z); // convert RGB to XYZ
+    XYZtoLAB(X, Y, Z, L, A, Bl); // convert XYZ to CIELab
+}
+
+//// Blacks, whites and grays classification cube
+//// Each 8-bit RGB value is classified for a set of limits the first time it is asked : 16M * 1 byte = 16 MB
+//// Same results as DistanceFromBlackRGB, DistanceFromWhiteRGB and DistanceFromGrayRGB compared to the limits,
+//// computed in double precision from the same CIELab values as the RGB to CIELab lookup cube
+
+static std::mutex AchromaticCubeMutex; // protects last cube
+static achromaticCube AchromaticCubeLast; // last cube asked
+
+achromaticCube AchromaticClassificationCube(const long double &blacks_limit, const long double &whites_limit, const long double &grays_limit) // cube for these limits
+{
+    std::lock_guard<std::mutex> lock(AchromaticCubeMutex); // one thread at a time
+
+    if ((AchromaticCubeLast) and (AchromaticCubeLast->blacks_limit == blacks_limit)
+            and (AchromaticCubeLast->whites_limit == whites_limit) and (AchromaticCubeLast->grays_limit == grays_limit)) // same limits as last time
+        return AchromaticCubeLast; // already classified values are kept
+
+    achromaticCube cube = std::make_shared<struct_achromatic_cube>(); // new cube : users of the old one keep it until they release it
+    cube->blacks_limit = blacks_limit;
+    cube->whites_limit = whites_limit;
+    cube->grays_limit = grays_limit;
+    for (int v = 0; v < 256; v++) { // gamma correction is computed only once for each 8-bit value
+        long double value = (long double)v / 255.0, linear;
+        GammaCorrectionToSRGB(value, value, value, linear, linear, linear);
+        cube->linear[v] = linear;
+    }
+    cube->flags = std::vector<std::atomic<unsigned char>>(256 * 256 * 256); // all values not classified yet
+
+    AchromaticCubeLast = cube; // keep it for next time
+    return cube;
+}
+
+unsigned char AchromaticClassification(const achromaticCube &cube, const int &R, const int &G, const int &B) // flags of 8-bit RGB value
+{
+    std::atomic<unsigned char> &value = cube->flags[(R << 16) | (G << 8) | B]; // position in cube
+    unsigned char flags = value.load(std::memory_order_relaxed);
+    if (flags != 0) // already classified
+        return flags;
+
+    double X, Y, Z, L, a, b;
+    double r = cube->linear[R];
+    double g = cube->linear[G];
+    double bl = cube->linear[B];
+    X = r * 0.4124564 + g * 0.3575761 + bl * 0.1804375; // same as RGB to CIELab cube
+    Y = r * 0.2126729 + g * 0.7151522 + bl * 0.0721750;
+    Z = r * 0.0193339 + g * 0.1191920 + bl * 0.9503041;
+    XYZtoLABKernel(X, Y, Z, L, a, b);
+    L = float(L); // values of RGB to CIELab cube are stored as float
+    a = float(a);
+    b = float(b);
+
+    double dBlack = CIEDE2000Kernel(L, a, b, 0.0, 0.0, 0.0, 1.0, 1.0, 1.0); // distances from black, white and gray
+    double dWhite = CIEDE2000Kernel(L, a, b, 1.0, 0.0, 0.0, 1.0, 1.0, 1.0);
+    double dGray = CIEDE2000Kernel(L, a, b, L, 0.0, 0.0, 1.0, 1.0, 1.0);
+
+    flags = achromatic_classified;
+    if (dBlack < cube->blacks_limit)
+        flags |= achromatic_black;
+    if (dWhite < cube->whites_limit)
+        flags |= achromatic_white;
+    if (dGray < cube->grays_limit)
+        flags |= achromatic_gray;
+    if (dWhite > cube->whites_limit)
+        flags |= achromatic_far_white;
+    if (dGray > cube->grays_limit)
+        flags |= achromatic_far_gray;
+    if ((dWhite > 5) and (dGray > 5))
+        flags |= achromatic_far_pale;
+
+    value.store(flags, std::memory_order_relaxed); // other threads computing the same value store the same flags
+    return flags;
+}
+
 //// CIE LCHab
 //// See https://en.wikipedia.org/wiki/CIELAB_color_space#Cylindrical_representation:_CIELCh_or_CIEHLC
 //// All values [0..1] except C
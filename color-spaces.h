@@ -20,6 +20,8 @@
 #    - CYMK
 #
 #  + RGB and CIELAb color utils
+#  + RGB to CIELab lookup cube
+#  + blacks, whites and grays classification cube
 #
 #-------------------------------------------------*/
 
@@ -27,6 +29,9 @@
 #define COLORSPACES
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
 
 //// palette
 
@@ -135,6 +140,28 @@ long double DistanceFromGrayRGB(const long double &R, const long double &G, cons
 long double DistanceRGB(const long double &R1, const long double &G1, const long double &B1,
                         const long double &R2, const long double &G2, const long double &B2, const long double k_L, const long double k_C, const long double k_H); // CIEDE2000 distance between 2 RGB values
 
+//// Blacks, whites and grays classification of all 8-bit RGB values
+//// Flags depend only on the CIEDE2000 distances from black, white and gray, and on the limits
+
+enum achromaticFlags {  achromatic_black = 1, // distance from black < blacks limit
+                        achromatic_white = 2, // distance from white < whites limit
+                        achromatic_gray = 4, // distance from gray < grays limit
+                        achromatic_far_white = 8, // distance from white > whites limit
+                        achromatic_far_gray = 16, // distance from gray > grays limit
+                        achromatic_far_pale = 32, // distances from white and gray > 5
+                        achromatic_classified = 64 // value already classified
+                     };
+
+struct struct_achromatic_cube { // flags of all 8-bit RGB values for one set of limits, filled on first use of each value
+    long double blacks_limit, whites_limit, grays_limit; // limits of this cube
+    double linear[256]; // gamma correction of 8-bit values
+    std::vector<std::atomic<unsigned char>> flags; // 16 MB, index = (R << 16 | G << 8 | B) - 0 = not classified yet
+};
+typedef std::shared_ptr<struct_achromatic_cube> achromaticCube;
+
+achromaticCube AchromaticClassificationCube(const long double &blacks_limit, const long double &whites_limit, const long double &grays_limit); // cube for these limits, the same one is returned while limits don't change
+unsigned char AchromaticClassification(const achromaticCube &cube, const int &R, const int &G, const int &B); // flags of 8-bit RGB value - classified on first use, thread-safe
+
 //// RGB
 
 void RGBMean(const long double &R1, const long double &G1, const long double &B1, const long double W1,
@@ -180,6 +207,12 @@ void LABtoLCHab(const long double &A, const long double &B, long double &C, long
 void LCHabToLAB(const long double &C, const long double &H, long double &A, long double &B); // convert from LCH to LAB - L is the same so no need to convert
 void LCHabtoStandard(const long double &l, const long double &c, const long double &h, int &L, int &C, int &H); // convert CIE LCHab [0..1] to CIE LCHab L [0..100] C [0..100+] H [0..359]
 
+void EnableRGBtoLabCube(const bool &enable); // use (or not) the RGB to CIELab lookup cube - 192 MB, built on first use
+bool IsRGBtoLabCubeEnabled(); // is RGB to CIELab lookup cube used ?
+const float* RGBtoLabCube(); // pointer to RGB to CIELab lookup cube, built if needed - index = (R << 16 | G << 8 | B) * 3 -> L, a, b
+void RGBtoLABCube(const int &R, const int &G, const int &B, long double &L, long double &A, long double &Bl); // 8-bit RGB [0..255] to CIELab [0..1] with lookup cube
+void RGBtoLAB(const long double &R, const long double &G, const long double &B, long double &L, long double &A, long double &Bl); // convert RGB value to CIELab - uses lookup cube for 8-bit values
+
 void XYZtoLuv(const long double &X, const long double &Y, const long double &Z, long double &L, long double &u, long double &v); // convert CIE XYZ value to CIE L*u*v*
 void LuvToXYZ(const long double &L, const long double &u, const long double &v, long double &X, long double &Y, long double &Z); // convert CIE L*u*v* value to CIE XYZ
 void LuvToStandard(const long double &l, const long double &u, const long double &v, int &L, int &U, int &V); // convert CIELab [0..1] to CIELab L [0..100] u and v [-100..100]
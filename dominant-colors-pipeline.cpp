@@ -0,0 +1,717 @@
+/*#-------------------------------------------------
+#
+#     Dominant colors pipeline with openCV
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - image preprocessing (blur, reduce size)
+#   - grays filter, quantization, palette cleaning,
+#     regroup, percentage filter and color names
+#   - tiled mode for images too big to be
+#     processed at once
+#   - sequence mode for videos and numbered images
+#   - no Qt dependency : used by GUI and command-line
+#
+#-------------------------------------------------*/
+
+#include <cstdio>
+#include <climits>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <opencv2/opencv.hpp>
+
+#include "dominant-colors-pipeline.h"
+#include "dominant-colors.h"
+#include "color-spaces.h"
+#include "mat-image-tools.h"
+#include "profiler.h"
+
+cv::Mat PreprocessImage(const cv::Mat &source, const bool &gaussian_blur, const bool &reduce_size) // gaussian blur and reduce size to 512 pixels
+{
+    ProfileStage stage("preprocess");
+    cv::Mat image = source; // no copy : blur and resize create new images
+
+    if (gaussian_blur) { // gaussian blur ?
+        cv::Mat blurred;
+        cv::GaussianBlur(image, blurred, cv::Size(3,3), 0, 0); // blur image
+        image = blurred;
+    }
+    if (reduce_size) // reduce size ?
+        if ((image.rows > 512) or (image.cols > 512)) image = ResizeImageAspectRatio(image, cv::Size(512,512)); // resize image
+
+    return image;
+}
+
+void ComputeDominantColorValues(struct_dominant_color &color) // compute palette values from RGB for one color
+{
+    HSLChfromRGB((long double)(color.R / 255.0), (long double)(color.G / 255.0), (long double)(color.B / 255.0),
+               color.H, color.S, color.L, color.C, color.h); // get H, S and L
+
+    // hexadecimal value
+    char hex[8];
+    if (color.R == -1) // not a palette color, set it to 000000 because some filters use this to take out this color
+        snprintf(hex, sizeof(hex), "#000000");
+    else
+        snprintf(hex, sizeof(hex), "#%02X%02X%02X", color.R & 0xff, color.G & 0xff, color.B & 0xff); // compute hexa RGB value
+    color.hexa = hex; // save hex value
+
+    // distances to black, white and gray points, computed with CIEDE2000 distance algorithm
+    color.distanceBlack = DistanceFromBlackRGB(color.R / 255.0, color.G / 255.0, color.B / 255.0);
+    color.distanceWhite = DistanceFromWhiteRGB(color.R / 255.0, color.G / 255.0, color.B / 255.0);
+    color.distanceGray = DistanceFromGrayRGB(color.R / 255.0, color.G / 255.0, color.B / 255.0);
+}
+
+void ReportProgress(const dominantProgress &progress, const int &percent) // call progress callback if there is one
+{
+    if (progress)
+        progress(percent);
+}
+
+int FindColorGroup(std::vector<int> &parent, int n) // root of color n in disjoint-set, with path halving
+{
+    while (parent[n] != n) {
+        parent[n] = parent[parent[n]];
+        n = parent[n];
+    }
+    return n;
+}
+
+int ReplacedColor(const std::vector<int> &from, const std::vector<int> &to, const int &color) // new value of color if it is in sorted from, else same color
+{
+    std::vector<int>::const_iterator it = std::lower_bound(from.begin(), from.end(), color);
+    return ((it != from.end()) and (*it == color)) ? to[it - from.begin()] : color;
+}
+
+void MergeHistogram(std::vector<std::pair<int, int>> &histogram, std::vector<int> &hist_colors, std::vector<int> &hist_counts) // (color, count) pairs to sorted histogram, counts of same colors are merged
+{
+    std::sort(histogram.begin(), histogram.end()); // same colors are now together
+    hist_colors.clear();
+    hist_counts.clear();
+    for (size_t h = 0; h < histogram.size(); h++)
+        if ((hist_colors.empty()) or (hist_colors.back() != histogram[h].first)) { // new color
+            hist_colors.push_back(histogram[h].first);
+            hist_counts.push_back(histogram[h].second);
+        }
+        else
+            hist_counts.back() += histogram[h].second; // same color : merge counts
+}
+
+bool RegroupNearColors(std::vector<struct_dominant_color> &palettes, const int &nb_palettes, const long double &distance,
+                       std::vector<int> &from, std::vector<int> &to, std::vector<int> &hist_colors, std::vector<int> &hist_counts) // regroup palette colors nearer than CIEDE2000 distance - from -> to are the replaced colors, sorted
+{ // near colors are linked in a disjoint-set, each group becomes the weighted mean of its colors in linear RGB
+    std::vector<long double> L(nb_palettes), A(nb_palettes), B(nb_palettes); // CIELab values of palette, computed once
+    std::vector<bool> eligible(nb_palettes); // exclude black values and dummy colors
+    for (int n = 0; n < nb_palettes; n++) {
+        eligible[n] = (palettes[n].R >= 0) and (palettes[n].R + palettes[n].G + palettes[n].B != 0);
+        if (eligible[n])
+            RGBtoLAB((long double)palettes[n].R / 255.0, (long double)palettes[n].G / 255.0, (long double)palettes[n].B / 255.0, L[n], A[n], B[n]);
+    }
+
+    std::vector<uchar> near_colors(size_t(nb_palettes) * nb_palettes, 0); // pairwise distance matrix, only "near or not" is needed
+    cv::parallel_for_(cv::Range(0, nb_palettes), [&](const cv::Range &range) {
+        for (int n = range.start; n < range.end; n++) // upper triangle of matrix : distance is symmetric
+            if (eligible[n])
+                for (int i = n + 1; i < nb_palettes; i++)
+                    if (eligible[i])
+                        near_colors[size_t(n) * nb_palettes + i] = (distanceCIEDE2000LAB(L[n], A[n], B[n], L[i], A[i], B[i], 1.0, 0.5, 1.0) < distance); // distance with less for chroma
+    });
+
+    std::vector<int> parent(nb_palettes); // disjoint-set of colors
+    for (int n = 0; n < nb_palettes; n++)
+        parent[n] = n; // each color is its own group
+    bool regroup = false; // if two colors are regrouped this will be true
+    for (int n = 0; n < nb_palettes; n++)
+        for (int i = n + 1; i < nb_palettes; i++)
+            if (near_colors[size_t(n) * nb_palettes + i]) { // the two colors are near ("regroup" filter distance)
+                int root_n = FindColorGroup(parent, n);
+                int root_i = FindColorGroup(parent, i);
+                if (root_n != root_i) { // not already in the same group
+                    parent[std::max(root_n, root_i)] = std::min(root_n, root_i); // lowest index is the root
+                    regroup = true;
+                }
+            }
+    if (!regroup) // nothing to do
+        return false;
+
+    std::vector<long double> sumR(nb_palettes, 0), sumG(nb_palettes, 0), sumB(nb_palettes, 0), weight(nb_palettes, 0); // weighted sums in linear RGB for each group
+    std::vector<long double> percentage(nb_palettes, 0); // merged percentage of each group
+    std::vector<int> group_size(nb_palettes, 0); // number of colors in each group
+    for (int n = 0; n < nb_palettes; n++)
+        if (eligible[n]) {
+            int root = FindColorGroup(parent, n);
+            long double r, g, b;
+            GammaCorrectionToSRGB((long double)palettes[n].R / 255.0, (long double)palettes[n].G / 255.0, (long double)palettes[n].B / 255.0, r, g, b); // conversion to linear space - better for means
+            sumR[root] += r * palettes[n].count;
+            sumG[root] += g * palettes[n].count;
+            sumB[root] += b * palettes[n].count;
+            weight[root] += palettes[n].count;
+            percentage[root] += palettes[n].percentage;
+            group_size[root]++;
+        }
+
+    std::vector<int> new_color(nb_palettes, -1); // new color of each group, -1 = unchanged
+    for (int n = 0; n < nb_palettes; n++)
+        if ((group_size[n] > 1) and (weight[n] > 0)) { // root of a group of several colors
+            long double R, G, B;
+            GammaCorrectionFromSRGB(sumR[n] / weight[n], sumG[n] / weight[n], sumB[n] / weight[n], R, G, B); // mean in linear space, back to sRGB
+            new_color[n] = (int(round(R * 255.0)) << 16) | (int(round(G * 255.0)) << 8) | int(round(B * 255.0));
+        }
+
+    std::vector<std::pair<int, int>> replace; // old color -> new color, for quantized image and histogram
+    for (int n = 0; n < nb_palettes; n++) // new palette values
+        if (eligible[n]) {
+            int root = FindColorGroup(parent, n);
+            if (new_color[root] < 0) // color not regrouped
+                continue;
+            int old_color = (palettes[n].R << 16) | (palettes[n].G << 8) | palettes[n].B;
+            if (old_color != new_color[root]) // pixels of this color will change
+                replace.push_back(std::make_pair(old_color, new_color[root]));
+            if (root == n) { // the group is now one color
+                palettes[n].R = (new_color[n] >> 16) & 255; // replace colors in palette with new color values
+                palettes[n].G = (new_color[n] >> 8) & 255;
+                palettes[n].B = new_color[n] & 255;
+                palettes[n].count = weight[n]; // merged count
+                palettes[n].percentage = percentage[n]; // and merged percentage
+                ComputeDominantColorValues(palettes[n]); // compute new palette values other than RGB
+            }
+            else
+                palettes[n].R = -1; // dummy value : this color is now in its group
+        }
+
+    // replaced colors for quantized image, and histogram
+    std::sort(replace.begin(), replace.end()); // sorted by old color
+    from.resize(replace.size());
+    to.resize(replace.size());
+    for (size_t r = 0; r < replace.size(); r++) {
+        from[r] = replace[r].first;
+        to[r] = replace[r].second;
+    }
+
+    std::vector<std::pair<int, int>> histogram(hist_colors.size()); // histogram with new colors
+    for (size_t h = 0; h < hist_colors.size(); h++)
+        histogram[h] = std::make_pair(ReplacedColor(from, to, hist_colors[h]), hist_counts[h]);
+    MergeHistogram(histogram, hist_colors, hist_counts);
+
+    return true;
+}
+
+int DominantColorsAsked(const struct_dominant_params &params) // asked number of colors, no more than maximum
+{
+    int nb_palettes = params.nb_colors; // how many dominant colors
+    if (nb_palettes > nb_dominant_colors_max) // no more than maximum !
+        nb_palettes = nb_dominant_colors_max;
+    return nb_palettes;
+}
+
+void DominantPaletteFromHistogram(const struct_dominant_params &params, const struct_color_names &color_names, const int &nb_pixels,
+                                  int nb_palettes, const int &nb_palettes_asked, std::vector<int> &hist_colors, std::vector<int> &hist_counts,
+                                  std::vector<int> &replace_from, std::vector<int> &replace_to, struct_dominant_result &result,
+                                  ProfileStage &stage, const dominantProgress &progress) // palette from histogram of quantized image : cleaning, regroup, percentage filter and names - replace_from -> replace_to are the colors to change in quantized image
+{
+    // set all palette values to dummy values
+    std::vector<struct_dominant_color> palettes(nb_dominant_colors_max + 1); // palette, +1 for black
+    for (unsigned int n = 0; n < palettes.size(); n++) {
+        palettes[n].R = -1;
+        palettes[n].G = -1;
+        palettes[n].B = -1;
+        palettes[n].count = -1;
+        palettes[n].percentage = -1;
+        palettes[n].distanceBlack = 0;
+        palettes[n].distanceWhite = 100;
+        palettes[n].distanceGray = 100;
+        palettes[n].name = "";
+    }
+
+    int totalMean = 0; // number of colors obtained with Mean algorithms (mean-shift and sectored-means)
+
+    // palette from quantized image histogram : every color with its number of pixels
+    int nb_real = hist_colors.size(); // how many colors in quantized image, really ?
+    std::vector<int> order(nb_real); // histogram indexes
+    for (int i = 0; i < nb_real; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&hist_counts](const int &a, const int &b) {return hist_counts[a] > hist_counts[b];}); // sort colors by count, descending
+
+    int nbColor = nb_real; // number of colors to copy to palette
+    if ((params.algorithm == algorithm_mean_shift) or (params.algorithm == algorithm_sectored_means)) { // mean algorithms : intermediate number of colors unknown
+        int total = nb_pixels; // number of pixels in image
+        // clean insignificant colors by percentage
+        while ((nbColor > 1) and (double(hist_counts[order[nbColor - 1]]) / total < 0.005)) // is the last color percentage an insignificant value ?
+            nbColor--; // one less color to consider
+        if (nbColor > nb_dominant_colors_max) // number of colors must not be superior to max number of colors in palette
+            nbColor = nb_dominant_colors_max;
+        nb_palettes = nbColor; // real number of colors in palette
+    }
+    else if (nbColor > int(palettes.size())) // eigen and K-means : never more colors than asked, but stay in palette
+        nbColor = palettes.size();
+
+    for (int n = 0; n < nbColor; n++) { // for all colors in histogram
+        palettes[n].R = (hist_colors[order[n]] >> 16) & 255; // copy RGB values to global palette
+        palettes[n].G = (hist_colors[order[n]] >> 8) & 255;
+        palettes[n].B = hist_colors[order[n]] & 255;
+        totalMean += hist_counts[order[n]]; // compute total number of pixels for these colors
+    }
+
+    ReportProgress(progress, 70); // quantization done
+
+    // compute HSL values from RGB + hexa + distances
+    for (int n = 0; n < nb_palettes; n++) // for each color in palette
+        ComputeDominantColorValues(palettes[n]); // compute values other than RGB
+
+    // clean palette : number of asked colors may be superior to number of colors found
+    if (nb_real < nb_palettes) { // if asked number of colors exceeds total number of colors in image
+        std::sort(palettes.begin(), palettes.begin() + nb_palettes,
+                  [](const struct_dominant_color& a, const struct_dominant_color& b) {return a.hexa > b.hexa;}); // sort palette by hexa value, decending
+        if (((palettes[0].R == palettes[1].R) and (palettes[0].G == palettes[1].G)
+                and (palettes[0].B == palettes[1].B)) or (palettes[0].R == -1)) // if first color in palette is equal to second or it's a dummy color -> we have to reverse sort
+            std::sort(palettes.begin(), palettes.begin() + nb_palettes,
+                      [](const struct_dominant_color& a, const struct_dominant_color& b) {return a.hexa > b.hexa;}); // sort the palette, this time by increasing hexa values
+        nb_palettes = nb_real; // new number of colors in palette
+    }
+
+    int total; // total number of pixels to consider for percentages
+    if ((params.algorithm == algorithm_mean_shift) or (params.algorithm == algorithm_sectored_means)) // particular case of mean algorithms
+        total = totalMean; // total is the mean total computed before
+    else // not mean algorithm
+        total = nb_pixels; // total is the size of quantized image in pixels
+
+    // delete blacks in palette if "filter grays" enabled because there really can be one blackish color in the quantized image that could have been mixed with others
+    if (params.filter_grays) { // delete last "black" values in palette
+        std::sort(palettes.begin(), palettes.begin() + nb_palettes,
+              [](const struct_dominant_color& a, const struct_dominant_color& b) {return a.distanceBlack > b.distanceBlack;}); // sort palette by distance from black, descending
+        while ((nb_palettes > 1) and (palettes[nb_palettes - 1].distanceBlack < params.blacks_limit)) { // at the end of palette, find black colors
+            int c = CountRGBValue(hist_colors, hist_counts, palettes[nb_palettes - 1].R, palettes[nb_palettes - 1].G, palettes[nb_palettes - 1].B); // how many pixels are black ?
+            total = total - c; // update total pixel count
+            palettes[nb_palettes - 1]. R = -1; // exclude this black color from palette
+            nb_palettes--; // one less color in palette
+        }
+    }
+
+    // compute percentages (NOT the final value)
+    for (int n = 0; n < nb_palettes; n++) { // for each color in palette
+        palettes[n].count = CountRGBValue(hist_colors, hist_counts, palettes[n].R, palettes[n].G, palettes[n].B); // count pixels of this color
+        palettes[n].percentage = (long double)(palettes[n].count) / (long double)(total); // compute color percentage in image
+    }
+
+    ReportProgress(progress, 80); // palette cleaned
+
+    // regroup near colors
+    stage.Next("regroup");
+    if (params.regroup) // is "regroup colors" enabled ?
+        if (RegroupNearColors(palettes, nb_palettes, params.regroup_distance, replace_from, replace_to, hist_colors, hist_counts)) { // at least one color regroup was found so palette has changed
+            std::sort(palettes.begin(), palettes.begin() + nb_palettes,
+                      [](const struct_dominant_color& a, const struct_dominant_color& b) {return a.R > b.R;}); // sort palette by R value, descending : excluded colors at the end
+            while ((nb_palettes > 1) and (palettes[nb_palettes - 1].R == -1)) // look for excluded colors
+                nb_palettes--; // update palette count
+        }
+
+    int nb_palettes_found = nb_palettes; // max number of colors found, keep it
+
+    // delete non significant values in palette by percentage
+    stage.Next("filtering");
+    if (params.filter_percent) { // filter by x% enabled ?
+        bool cleaning_found = false; // indicator
+        std::sort(palettes.begin(), palettes.begin() + nb_palettes,
+              [](const struct_dominant_color& a, const struct_dominant_color& b) {return a.percentage > b.percentage;}); // sort palette by percentage, descending
+        while ((nb_palettes > 1) and (palettes[nb_palettes - 1].percentage * 100 < params.filter_percentage)) { // at the end of palette, find colors < x% of image
+            int c = CountRGBValue(hist_colors, hist_counts, palettes[nb_palettes - 1].R, palettes[nb_palettes - 1].G, palettes[nb_palettes - 1].B); // count occurences of this color
+            total = total - c; // update total pixel count
+            nb_palettes--; // exclude this color from palette
+            if (c > 0) // really found this color ?
+                cleaning_found = true; // palettes count has changed
+        }
+        if (cleaning_found) { // if cleaning found
+            // re-compute percentages
+            for (int n = 0; n < nb_palettes; n++) // for each color in palette
+                palettes[n].percentage = (long double)(palettes[n].count) / (long double)(total); // update percentage with new total
+        }
+    }
+
+    ReportProgress(progress, 90); // palette filtered
+
+    // find color name by CIEDE2000 distance for all palette
+    stage.Next("naming");
+    for (int n = 0; n < nb_palettes; n++) // for each color in palette
+        palettes[n].name = NearestColorName(color_names, palettes[n].R, palettes[n].G, palettes[n].B); // find its name
+
+    if (nb_palettes < 1) // at least one color in palette !
+        nb_palettes = 1;
+    if (palettes[nb_palettes -1].R == -1) { // if the only color in palette is a dummy one
+        palettes[nb_palettes -1].R = 0; // "paint it black" !
+        palettes[nb_palettes -1].G = 0;
+        palettes[nb_palettes -1].B = 0;
+    }
+    if (nb_palettes > nb_palettes_asked) // limit number of colors to asked number of colors
+        nb_palettes = nb_palettes_asked;
+    if (nb_palettes_found < nb_palettes) // keep at least the colors to show
+        nb_palettes_found = nb_palettes;
+    if (nb_palettes_found > nb_dominant_colors_max) // no more than maximum !
+        nb_palettes_found = nb_dominant_colors_max;
+
+    stage.Stop();
+    ProfileCount("palette colors", nb_palettes_found);
+
+    // result
+    result.histogram_colors.swap(hist_colors); // histogram of quantized image
+    result.histogram_counts.swap(hist_counts);
+    result.palette.assign(palettes.begin(), palettes.begin() + nb_palettes_found); // all colors found
+    result.nb_colors = nb_palettes; // number of dominant colors
+    result.nb_asked = nb_palettes_asked; // number of asked colors
+}
+
+void ComputeDominantColors(const cv::Mat &image, const struct_dominant_params &params, const struct_color_names &color_names,
+                           struct_dominant_result &result, const dominantProgress &progress) // compute dominant colors and quantized image from RGB image
+{
+    ProfileStage stage("gray filter"); // stages are timed if a profile is active
+    result.kmeans_centers.release(); // only set by K-means
+    cv::Mat imageCopy; // work on a copy of the image, because gray colors can be filtered
+    image.copyTo(imageCopy);
+    cv::Mat quantized; // quantized image
+
+    ReportProgress(progress, 0); // starting
+
+    bool has_black = false; // will be true if filtered image contains black pixels
+    if (params.filter_grays) { // filter whites, blacks and grays if gray filter is set
+        achromaticCube cube = AchromaticClassificationCube(params.blacks_limit, params.whites_limit, params.grays_limit); // classification of RGB values for these limits
+        const int nb_bands = NbRowBands(imageCopy);
+        std::vector<uchar> band_black(nb_bands, 0); // black pixels found in each band
+        cv::parallel_for_(cv::Range(0, nb_bands), [&](const cv::Range &range) {
+            for (int band = range.start; band < range.end; band++)
+                for (int y = imageCopy.rows * band / nb_bands; y < imageCopy.rows * (band + 1) / nb_bands; y++) {
+                    cv::Vec3b *RGB = imageCopy.ptr<cv::Vec3b>(y); // current row of temp image
+                    for (int x = 0; x < imageCopy.cols; x++) {
+                        if (AchromaticClassification(cube, RGB[x][2], RGB[x][1], RGB[x][0]) & (achromatic_black | achromatic_white | achromatic_gray)) // white or black or gray pixel ?
+                            RGB[x] = cv::Vec3b(0, 0, 0); // replace it with black in temp image
+                        if (RGB[x] == cv::Vec3b(0, 0, 0)) // black pixel in temp image ?
+                            band_black[band] = 1;
+                    }
+                }
+        });
+        has_black = (std::find(band_black.begin(), band_black.end(), 1) != band_black.end());
+    }
+
+    int nb_palettes_asked = DominantColorsAsked(params); // save asked number of colors for later
+    int nb_palettes = nb_palettes_asked; // how many dominant colors
+    if (has_black) // if grays and blacks and whites are filtered and image contains black pixels (= whites and blacks and grays)
+        nb_palettes++; // add one color to asked number of colors in palette, to remove it later and only get colors
+
+    ReportProgress(progress, 10); // grays filtered
+
+    if (params.algorithm == algorithm_mean_shift) { // mean-shift algorithm checked : intermediate number of colors unknown
+        stage.Next("Lab conversion");
+        cv::Mat temp = ImgRGBtoLab(imageCopy); // convert image to CIELab
+
+        stage.Next("clustering");
+        MeanShift MSProc(params.mean_shift_spatial, params.mean_shift_color); // create instance of Mean-shift
+        MSProc.MeanShiftFilteringCIELab(temp); // Mean-shift filtering
+        MSProc.MeanShiftSegmentationCIELab(temp); // Mean-shift segmentation
+        stage.Next("Lab conversion");
+        quantized = ImgLabToRGB(temp); // convert image back to RGB
+    }
+    else if (params.algorithm == algorithm_eigen_vectors) { // eigen method : number of colors known from the start
+        stage.Next("Lab conversion");
+        cv::Mat conv = ImgRGBtoLab(imageCopy); // convert image to CIELab
+        stage.Next("clustering");
+        cv::Mat result;
+        std::vector<cv::Vec3f> temp;
+        temp = DominantColorsEigenCIELab(conv, nb_palettes, result); // get dominant palette, palette image and quantized image
+
+        stage.Next("Lab conversion");
+        quantized = ImgLabToRGB(result); // convert Quantized back to RGB
+    }
+    else if (params.algorithm == algorithm_k_means) { // K-means algorithm : number of colors known from the start
+        stage.Next("clustering"); // CIELab conversions are nested stages
+        cv::Mat1f colors; // store palette from K-means
+        if (params.kmeans_mode == kmeans_unique_colors) // weighted K-means on unique colors
+            quantized = DominantColorsKMeansCIELABUnique(imageCopy, nb_palettes, colors, params.kmeans_initial_centers); // get quantized image and palette
+        else if (params.kmeans_mode == kmeans_mini_batch) // mini-batch K-means on random pixels
+            quantized = DominantColorsKMeansCIELABMiniBatch(imageCopy, nb_palettes, params.kmeans_batch_size, params.kmeans_tolerance, colors,
+                                                            params.kmeans_initial_centers); // get quantized image and palette
+        else // K-means on all pixels
+            quantized = DominantColorsKMeansCIELAB(imageCopy, nb_palettes, colors, params.kmeans_initial_centers); // get quantized image and palette
+        result.kmeans_centers = colors; // warm start of next frame
+    }
+    else if (params.algorithm == algorithm_sectored_means) { // sectored-means : intermediate number of colors unknown
+        stage.Next("clustering");
+        if (params.sectored_means_levels) // choice of Chroma and Lightness levels ?
+            SectoredMeansSegmentationLevels(imageCopy, params.sectored_means_nb_levels, quantized); // get sectored-means quantized with choice of levels
+        else
+            SectoredMeansSegmentationCategories(imageCopy, quantized); // get sectored-means quantized without choice of levels
+    }
+    imageCopy.release(); // not needed anymore
+
+    // palette from quantized image : one histogram pass gives every color with its number of pixels
+    stage.Next("palette extraction");
+    std::vector<int> hist_colors, hist_counts; // histogram of quantized image, sorted by color
+    CountRGBUniqueValues(quantized, hist_colors, hist_counts);
+    std::vector<int> replace_from, replace_to; // colors changed by regroup
+    DominantPaletteFromHistogram(params, color_names, quantized.rows * quantized.cols, nb_palettes, nb_palettes_asked,
+                                 hist_colors, hist_counts, replace_from, replace_to, result, stage, progress);
+
+    if (!replace_from.empty()) { // regrouped colors : change quantized image in one pass
+        ProfileStage regroup_stage("regroup");
+        ReplaceRGBValues(quantized, replace_from, replace_to);
+    }
+
+    ReportProgress(progress, 100); // done
+    result.quantized = quantized; // quantized image
+}
+
+///////////////////////////////////////////////////////////
+//// Tiled : images too big to be processed at once
+///////////////////////////////////////////////////////////
+
+dominantBandReader MatBandReader(const cv::Mat &image) // band reader of an image already in memory : bands are views, no copy
+{
+    return [image](const int &y, const int &nb_rows, cv::Mat &band) {
+        band = image.rowRange(y, y + nb_rows);
+        return true;
+    };
+}
+
+int TiledBandRows(const int &cols, const int &memory_mb) // number of rows of bands for a memory budget
+{
+    const long long bytes_per_row = (long long)(cols) * (3 + 3 + 8); // BGR source and quantized bands + sorted keys of band histogram, see CountRGBUniqueValues
+    const long long band_rows = (long long)(memory_mb) * 1024 * 1024 / bytes_per_row;
+    return int(std::max(1LL, std::min(band_rows, (long long)(INT_MAX))));
+}
+
+bool ComputeDominantColorsTiled(const int &rows, const int &cols, const dominantBandReader &read_band, const int &band_rows,
+                                const struct_dominant_params &params, const struct_color_names &color_names, struct_dominant_result &result,
+                                const dominantBandWriter &write_band, const dominantProgress &progress) // compute dominant colors of an image read band by band
+{ // the image is read twice : first pass for the histogram of its colors, clustering is done on this histogram, second pass to write the quantized bands
+    if ((rows <= 0) or (cols <= 0) or (band_rows <= 0) or ((long long)(rows) * cols > INT_MAX)) // pixel counts are int
+        return false;
+    if (params.algorithm == algorithm_mean_shift) // mean-shift needs the neighbors of each pixel, not only its color
+        return false;
+    const int nb_pixels = rows * cols;
+    result.kmeans_centers.release(); // only set by K-means
+
+    ReportProgress(progress, 0); // starting
+
+    // histogram of image : number of pixels of all 2^24 RGB values, 64 MB whatever the size of the image
+    ProfileStage stage("histogram"); // includes reading bands
+    std::vector<int> dense(1 << 24, 0); // index = (R << 16 | G << 8 | B) - later the quantized color of each value
+    for (int y = 0; y < rows; y += band_rows) {
+        const int nb_rows = std::min(band_rows, rows - y); // last band can be smaller
+        cv::Mat band;
+        if ((!read_band(y, nb_rows, band)) or (band.rows != nb_rows) or (band.cols != cols) or (band.type() != CV_8UC3)) // reading error
+            return false;
+        std::vector<int> band_colors, band_counts; // histogram of band
+        CountRGBUniqueValues(band, band_colors, band_counts);
+        for (size_t i = 0; i < band_colors.size(); i++)
+            dense[band_colors[i]] += band_counts[i];
+        ReportProgress(progress, int(10LL * (y + nb_rows) / rows));
+    }
+
+    // filter whites, blacks and grays : they are counted as black, like pixels replaced with black
+    stage.Next("gray filter");
+    achromaticCube cube; // classification of RGB values for these limits
+    if (params.filter_grays)
+        cube = AchromaticClassificationCube(params.blacks_limit, params.whites_limit, params.grays_limit);
+    auto Filtered = [&params, &cube](const int &color) { // is this RGB value replaced with black ?
+        return (color == 0) or ((params.filter_grays)
+                                and (AchromaticClassification(cube, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF) & (achromatic_black | achromatic_white | achromatic_gray)));
+    };
+    std::vector<int> colors(1, 0), counts(1, 0); // unique colors of filtered image, sorted - black first
+    for (int color = 1; color < (1 << 24); color++)
+        if (dense[color] > 0) {
+            if (Filtered(color))
+                counts[0] += dense[color];
+            else {
+                colors.push_back(color);
+                counts.push_back(dense[color]);
+            }
+        }
+    counts[0] += dense[0];
+    if (counts[0] == 0) { // no black pixel in filtered image
+        colors.erase(colors.begin());
+        counts.erase(counts.begin());
+    }
+    const bool has_black = (params.filter_grays) and (colors[0] == 0); // same as filtered image with black pixels
+
+    int nb_palettes_asked = DominantColorsAsked(params); // save asked number of colors for later
+    int nb_palettes = nb_palettes_asked; // how many dominant colors
+    if (has_black) // add one color to asked number of colors in palette, to remove it later and only get colors
+        nb_palettes++;
+
+    ReportProgress(progress, 10); // grays filtered
+
+    // clustering on unique colors weighted by their number of pixels : quantized color of each unique color
+    stage.Next("clustering"); // CIELab conversions are nested stages
+    std::vector<int> quantized_colors;
+    if (params.algorithm == algorithm_eigen_vectors)
+        DominantColorsEigenCIELabColors(colors, counts, nb_palettes, quantized_colors);
+    else if (params.algorithm == algorithm_k_means) { // all K-means variants : same weighted K-means on the histogram
+        cv::Mat1f centers; // palette from K-means
+        DominantColorsKMeansCIELABColors(colors, counts, nb_palettes, centers, quantized_colors, params.kmeans_initial_centers);
+        result.kmeans_centers = centers; // warm start of next frame
+    }
+    else if (params.sectored_means_levels) // sectored-means with choice of Chroma and Lightness levels ?
+        SectoredMeansColorsLevels(colors, counts, params.sectored_means_nb_levels, quantized_colors);
+    else
+        SectoredMeansColorsCategories(colors, counts, quantized_colors);
+
+    // histogram of quantized image, without the quantized image
+    stage.Next("palette extraction");
+    std::vector<std::pair<int, int>> histogram(colors.size()); // (quantized color, count) of each unique color
+    for (size_t i = 0; i < colors.size(); i++)
+        histogram[i] = std::make_pair(quantized_colors[i], counts[i]);
+    std::vector<int> hist_colors, hist_counts; // histogram of quantized image, sorted by color
+    MergeHistogram(histogram, hist_colors, hist_counts);
+    histogram.clear();
+    std::vector<int> replace_from, replace_to; // colors changed by regroup
+    DominantPaletteFromHistogram(params, color_names, nb_pixels, nb_palettes, nb_palettes_asked,
+                                 hist_colors, hist_counts, replace_from, replace_to, result, stage, progress);
+
+    // quantized color of each RGB value of the image, regrouped colors included
+    stage.Next("quantized output"); // includes reading and writing bands
+    for (size_t i = 0; i < quantized_colors.size(); i++)
+        quantized_colors[i] = ReplacedColor(replace_from, replace_to, quantized_colors[i]);
+    for (int color = 0; color < (1 << 24); color++)
+        if (dense[color] > 0) // color in image
+            dense[color] = quantized_colors[std::lower_bound(colors.begin(), colors.end(), Filtered(color) ? 0 : color) - colors.begin()];
+
+    // second pass : quantized bands
+    result.quantized.release();
+    if (!write_band) // no writer : quantized image in result
+        result.quantized.create(rows, cols, CV_8UC3);
+    cv::Mat output; // quantized band
+    for (int y = 0; y < rows; y += band_rows) {
+        const int nb_rows = std::min(band_rows, rows - y); // last band can be smaller
+        cv::Mat band;
+        if ((!read_band(y, nb_rows, band)) or (band.rows != nb_rows) or (band.cols != cols) or (band.type() != CV_8UC3)) // reading error
+            return false;
+        if (write_band)
+            output.create(nb_rows, cols, CV_8UC3);
+        else
+            output = result.quantized.rowRange(y, y + nb_rows); // written directly in quantized image
+        cv::parallel_for_(cv::Range(0, nb_rows), [&](const cv::Range &range) {
+            for (int row = range.start; row < range.end; row++) {
+                const cv::Vec3b *RGB = band.ptr<cv::Vec3b>(row); // source pixels
+                cv::Vec3b *quantized = output.ptr<cv::Vec3b>(row); // quantized pixels
+                for (int x = 0; x < cols; x++) {
+                    const int color = dense[(RGB[x][2] << 16) | (RGB[x][1] << 8) | RGB[x][0]];
+                    quantized[x] = cv::Vec3b(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF);
+                }
+            }
+        });
+        if ((write_band) and (!write_band(y, output))) // writing error
+            return false;
+        ReportProgress(progress, 90 + int(10LL * (y + nb_rows) / rows));
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+//// Sequence : videos and numbered images
+///////////////////////////////////////////////////////////
+
+int ComputeDominantColorsSequence(const std::string &source, const int &frame_step, const bool &gaussian_blur, const bool &reduce_size,
+                                  const struct_dominant_params &params, const struct_color_names &color_names,
+                                  const dominantFrameDone &frame_done) // compute dominant colors of frames of a video or numbered images
+{
+    cv::VideoCapture capture(source); // video file, or numbered images with a printf-like pattern
+    if (!capture.isOpened())
+        return -1;
+
+    const int step = std::max(1, frame_step); // one frame computed every step frames
+    const size_t nb_frames_ahead = 2; // decoded frames waiting to be computed
+    std::deque<struct_dominant_frame> decoded; // frames waiting to be computed
+    std::mutex mutex; // protects decoded, decoding_ended and stop
+    std::condition_variable changed; // decoded frames changed, or decoding ended, or stop asked
+    bool decoding_ended = false; // no more frames to come
+    bool stop = false; // frame_done asked to stop, or computing failed
+    std::exception_ptr decoding_error; // other error than a bad frame in decoder thread, thrown again by this thread
+
+    std::thread decoder([&]() { // decode and preprocess frames while the previous one is computed
+        try {
+            for (int index = 0; ; index++) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (stop)
+                        break;
+                }
+                if (index % step != 0) { // skipped frame : not decoded
+                    if (!capture.grab())
+                        break;
+                    continue;
+                }
+                cv::Mat image;
+                if ((!capture.read(image)) or (image.empty())) // end of sequence
+                    break;
+
+                struct_dominant_frame frame;
+                frame.index = index;
+                frame.time = capture.get(cv::CAP_PROP_POS_MSEC);
+                frame.image = PreprocessImage(image, gaussian_blur, reduce_size); // blur and resize
+
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return (decoded.size() < nb_frames_ahead) or (stop); }); // don't decode too far ahead
+                if (stop)
+                    break;
+                decoded.push_back(frame);
+                changed.notify_all();
+            }
+        }
+        catch (const cv::Exception &) { // decoding error : end of sequence
+        }
+        catch (...) { // e.g. out of memory : given to computing thread
+            decoding_error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        decoding_ended = true;
+        changed.notify_all();
+    });
+
+    int nb_frames = 0; // frames computed
+    struct_dominant_params frame_params = params; // K-means initial centers change with each frame
+    try {
+        while (true) {
+            struct_dominant_frame frame;
+            {
+                ProfileStage stage("decode wait"); // time lost waiting for decoder
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return (!decoded.empty()) or (decoding_ended); });
+                if (decoded.empty()) // all frames computed
+                    break;
+                frame = decoded.front();
+                decoded.pop_front();
+                changed.notify_all();
+            }
+
+            ComputeDominantColors(frame.image, frame_params, color_names, frame.result); // compute dominant colors
+            if (params.algorithm == algorithm_k_means) // warm start : next frame starts from these centers, one K-means attempt instead of 100
+                frame_params.kmeans_initial_centers = frame.result.kmeans_centers;
+            ProfileCount("frames", 1);
+            nb_frames++;
+
+            if (!frame_done(frame)) { // stop asked
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+                changed.notify_all();
+                break;
+            }
+        }
+    }
+    catch (...) { // computing or frame_done failed : stop decoder before leaving, a joinable thread can't be destroyed
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+            changed.notify_all();
+        }
+        decoder.join();
+        throw;
+    }
+
+    decoder.join();
+    if (decoding_error) // decoder failed
+        std::rethrow_exception(decoding_error);
+    return nb_frames;
+}
@@ -0,0 +1,107 @@
+/*#-------------------------------------------------
+#
+#     Dominant colors pipeline with openCV
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - image preprocessing (blur, reduce size)
+#   - grays filter, quantization, palette cleaning,
+#     regroup, percentage filter and color names
+#   - tiled mode for images too big to be
+#     processed at once
+#   - sequence mode for videos and numbered images
+#   - no Qt dependency : used by GUI and command-line
+#
+#-------------------------------------------------*/
+
+#ifndef DOMINANTPIPELINE_H
+#define DOMINANTPIPELINE_H
+
+#include <functional>
+
+#include "opencv2/opencv.hpp"
+
+#include "color-names.h"
+
+const int nb_dominant_colors_max = 500; // maximum number of colors in palette
+
+enum dominantAlgorithm {algorithm_sectored_means, algorithm_eigen_vectors, algorithm_k_means, algorithm_mean_shift}; // quantization algorithms
+enum kmeansMode {kmeans_all_pixels, kmeans_unique_colors, kmeans_mini_batch}; // K-means on every pixel, on weighted unique colors, or on random pixels batches
+
+struct struct_dominant_params { // pipeline parameters, default values are the same as in GUI
+    int algorithm = algorithm_sectored_means; // quantization algorithm
+    int nb_colors = 12; // number of dominant colors asked
+    bool filter_grays = true; // filter whites, blacks and grays
+    long double blacks_limit = 18; // CIEDE2000 distance limits for blacks, grays and whites
+    long double grays_limit = 9;
+    long double whites_limit = 18;
+    bool regroup = true; // regroup near colors
+    long double regroup_distance = 15; // CIEDE2000 distance to regroup colors
+    bool filter_percent = true; // filter colors representing less than x% of image
+    int filter_percentage = 1; // x% for this filter
+    int kmeans_mode = kmeans_unique_colors; // K-means variant
+    int kmeans_batch_size = 4096; // mini-batch K-means : random pixels in each batch
+    double kmeans_tolerance = 0.001; // mini-batch K-means : stop when centers move less than this (CIELab in [0..1])
+    int mean_shift_spatial = 4; // mean-shift spatial radius
+    int mean_shift_color = 12; // mean-shift color radius
+    bool sectored_means_levels = false; // sectored-means : use Lightness and Chroma levels instead of categories
+    int sectored_means_nb_levels = 3; // number of levels
+    cv::Mat1f kmeans_initial_centers; // K-means warm start : CIELab centers to start from, e.g. of previous frame in a sequence - empty = cold start
+};
+
+struct struct_dominant_color { // structure of a color value in palette
+    int R; // RGB in [0..255] - -1 = dummy value
+    int G;
+    int B;
+    long double H, S, L, C, h; // in [0..1]
+    long double distanceBlack, distanceWhite, distanceGray; // distance from gray values
+    std::string hexa; // hexadecimal RGB
+    int count; // number of pixels of this RGB color in image
+    long double percentage; // percentage of use in image
+    std::string name; // color name - empty if not computed
+};
+
+struct struct_dominant_result { // pipeline result
+    cv::Mat quantized; // quantized image
+    std::vector<int> histogram_colors, histogram_counts; // histogram of quantized image - see CountRGBUniqueValues
+    std::vector<struct_dominant_color> palette; // all colors found - the first nb_colors are the dominant colors
+    int nb_colors = 0; // number of dominant colors in palette
+    int nb_asked = 0; // number of colors asked
+    cv::Mat1f kmeans_centers; // K-means CIELab centers found, one per row - warm start of next frame in a sequence - empty for other algorithms
+};
+
+typedef std::function<void(const int &percent)> dominantProgress; // progress callback : percentage of work done - called from the computing thread
+typedef std::function<bool(const int &y, const int &nb_rows, cv::Mat &band)> dominantBandReader; // tiled mode : read rows [y..y + nb_rows[ of image as BGR CV_8UC3 - bands are read in order, twice - returns false on error
+typedef std::function<bool(const int &y, const cv::Mat &band)> dominantBandWriter; // tiled mode : write quantized band starting at row y - bands are written in order - returns false on error
+
+cv::Mat PreprocessImage(const cv::Mat &source, const bool &gaussian_blur, const bool &reduce_size); // gaussian blur and reduce size to 512 pixels
+void ComputeDominantColorValues(struct_dominant_color &color); // compute palette values from RGB for one color : HSLCh + hexa + distances
+void ComputeDominantColors(const cv::Mat &image, const struct_dominant_params &params, const struct_color_names &color_names,
+                           struct_dominant_result &result, const dominantProgress &progress = dominantProgress()); // compute dominant colors and quantized image from RGB image - optional progress callback
+
+// tiled mode : the image is read band by band, its colors are counted in a fixed size histogram, clustering is done on the histogram, then quantized bands are written
+// memory used : bands + 64 MB + unique colors, whatever the size of the image - same result as ComputeDominantColors for sectored-means and weighted K-means
+// eigen vectors works on weighted unique colors, K-means on all pixels is replaced by weighted K-means, mean-shift is not available (returns false)
+const int tiled_memory_default = 256; // default memory budget of bands in MB
+dominantBandReader MatBandReader(const cv::Mat &image); // band reader of an image already in memory : bands are views, no copy
+int TiledBandRows(const int &cols, const int &memory_mb); // number of rows of bands for a memory budget in MB
+bool ComputeDominantColorsTiled(const int &rows, const int &cols, const dominantBandReader &read_band, const int &band_rows,
+                                const struct_dominant_params &params, const struct_color_names &color_names, struct_dominant_result &result,
+                                const dominantBandWriter &write_band = dominantBandWriter(), const dominantProgress &progress = dominantProgress()); // no writer = quantized image in result - returns false on error
+
+// sequence mode : video file or numbered images pattern like "frame-%04d.png" read by cv::VideoCapture
+// frames are decoded on another thread while the previous frame is computed, K-means starts from the centers of previous frame
+struct struct_dominant_frame { // one computed frame of a sequence
+    int index; // frame number in sequence, from 0
+    double time; // position in milliseconds - 0 for images sequences
+    cv::Mat image; // frame after preprocessing
+    struct_dominant_result result; // palette and quantized frame
+};
+typedef std::function<bool(const struct_dominant_frame &frame)> dominantFrameDone; // called for each computed frame, in order - returns false to stop
+int ComputeDominantColorsSequence(const std::string &source, const int &frame_step, const bool &gaussian_blur, const bool &reduce_size,
+                                  const struct_dominant_params &params, const struct_color_names &color_names,
+                                  const dominantFrameDone &frame_done); // compute one frame every frame_step frames - returns number of frames computed, -1 if source can't be opened
+
+#endif // DOMINANTPIPELINE_H
@@ -8,7 +8,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -23,14 +23,21 @@ SOURCES += main.cpp\
         mainwindow.cpp \
         mat-image-tools.cpp \
         dominant-colors.cpp \
+        dominant-colors-pipeline.cpp \
+        color-names.cpp \
         color-spaces.cpp \
-        angles.cpp
+        angles.cpp \
+        profiler.cpp
 
 HEADERS  += mainwindow.h \
             mat-image-tools.h \
             dominant-colors.h \
+            dominant-colors-pipeline.h \
+            color-names.h \
             color-spaces.h \
-            angles.h
+            color-spaces-kernels.h \
+            angles.h \
+            profiler.h
 
 FORMS    += mainwindow.ui
 
@@ -42,3 +49,6 @@ PKGCONFIG += opencv4
 RESOURCES += resources.qrc
 
 CONFIG += c++11
+
+# color names table generated at build time from color-names.csv : compiled-in, no CSV parsing at launch
+include(color-names-table.pri)
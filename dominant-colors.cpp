@@ -12,11 +12,18 @@
 #
 #-------------------------------------------------*/
 
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <queue>
+
 #include <opencv2/opencv.hpp>
 
 #include "dominant-colors.h"
 #include "color-spaces.h"
 #include "mat-image-tools.h"
+#include "profiler.h"
 
 ///////////////////////////////////////////////
 ////         Sectored-Means algorithm
@@ -69,88 +76,176 @@ int WhichChromaCategory(const int &C, const int &colorSector) // get the Chroma
     return c; // return Chroma category
 }
 
-void SectoredMeansSegmentationLevels(const cv::Mat &image, const int &nb_levels, cv::Mat &quantized) // image segmentation by color sector mean (H from HSL)
+void SectoredMeansLinearTable(int linear[256]) // RGB values in linear space => to compute mean, rounded to 8-bit like the former mask images
 {
-    quantized = cv::Mat::zeros(image.rows, image.cols, CV_8UC3); // init quantized image = black
-    cv::Mat mask_sector[nb_color_sectors][nb_levels][nb_levels]; // mask for each sector
-    for (int s = 0; s < nb_color_sectors; s++) // init these masks to black
-        for (int l = 0; l < nb_levels; l++)
-            for (int c = 0; c < nb_levels; c++)
-                mask_sector[s][l][c] = cv::Mat::zeros(image.rows, image.cols, CV_8UC3); // zero mask of same size than image
-
-    cv::Vec3b RGB;
-    long double H, S, L, C, h, r, g, b;
-    for (int x = 0; x < image.cols; x++) // parse image
-        for (int y = 0; y < image.rows; y++) {
-            RGB = image.at<cv::Vec3b>(y, x); // get current pixel
-            HSLChfromRGB((long double)RGB[2] / 255.0, (long double)RGB[1] / 255.0, (long double)RGB[0] / 255.0, H, S, L, C, h); // get "HSLC" from RGB
-
-            int l = int(L * nb_levels); // get Lightness range of current pixel
-            if (l >= nb_levels - 1) // stay in range
-                l = nb_levels - 1;
-            int c = int(C * nb_levels); // get Chroma range of current pixel
-            if (c >= nb_levels - 1) // stay in range
-                c = nb_levels - 1;
-
-            H *= 360.0; // Hue in degrees
-            int s = WhichColorSector(H); // get color sector of current pixel
-            GammaCorrectionToSRGB(RGB[2] / 255.0, RGB[1] / 255.0, RGB[0] / 255.0, r, g, b); // RGB value in linear space => to compute mean
-            mask_sector[s][l][c].at<cv::Vec3b>(y, x) = cv::Vec3b(round(b * 255.0), round(g * 255.0), round(r * 255.0)); // copy pixel in the right sector mask
-        }
+    for (int v = 0; v < 256; v++) {
+        long double r, g, b;
+        GammaCorrectionToSRGB(v / 255.0, v / 255.0, v / 255.0, r, g, b);
+        linear[v] = round(r * 255.0);
+    }
+}
 
-    int nb_pal = 0;
-    for (int s = 0; s < nb_color_sectors; s++) { // for each sector
-        for (int l = 0; l < nb_levels; l++)
-            for (int c = 0; c < nb_levels; c++) {
-                cv::Mat gray; // gray mask
-                cv::cvtColor(mask_sector[s][l][c], gray, cv::COLOR_BGR2GRAY); // countNonZero works only on a 1-dimension Mat
-                if (cv::countNonZero(gray) > 0) { // does the sector mask contain any values ?
-                    cv::Scalar mean = cv::mean(mask_sector[s][l][c], gray); // compute mean of entire sector
-                    GammaCorrectionFromSRGB(mean[2] / 255.0, mean[1] / 255.0, mean[0] / 255.0, r, g, b); // get rgb back from sRGB mean value
-                    quantized.setTo(cv::Vec3b(round(b * 255.0), round(g * 255.0), round(r * 255.0)), gray); // plot this mean color to quantized image from mask
-                    nb_pal++; // one more color in palette
+cv::Vec3b SectoredMeansBinColor(const int64_t sum[3], const int64_t &count) // mean color of a bin from its sum of linear BGR values
+{
+    long double r, g, b;
+    GammaCorrectionFromSRGB(double(sum[2]) / count / 255.0, double(sum[1]) / count / 255.0, double(sum[0]) / count / 255.0, r, g, b); // get rgb back from sRGB mean value
+    return cv::Vec3b(round(b * 255.0), round(g * 255.0), round(r * 255.0));
+}
+
+int SectoredMeansLevelsBin(const cv::Vec3b &RGB, const int &nb_levels) // bin = (sector * nb_levels + lightness level) * nb_levels + chroma level
+{
+    long double H, S, L, C, h;
+    HSLChfromRGB((long double)RGB[2] / 255.0, (long double)RGB[1] / 255.0, (long double)RGB[0] / 255.0, H, S, L, C, h); // get "HSLC" from RGB
+
+    int l = int(L * nb_levels); // get Lightness range of current pixel
+    if (l >= nb_levels - 1) // stay in range
+        l = nb_levels - 1;
+    int c = int(C * nb_levels); // get Chroma range of current pixel
+    if (c >= nb_levels - 1) // stay in range
+        c = nb_levels - 1;
+
+    H *= 360.0; // Hue in degrees
+    int s = WhichColorSector(H); // get color sector of current pixel
+
+    return (s * nb_levels + l) * nb_levels + c;
+}
+
+int SectoredMeansCategoriesBin(const cv::Vec3b &RGB) // bin = (sector * nb_lightness_categories + lightness category) * nb_chroma_categories + chroma category
+{
+    long double H, S, L, C, h;
+    HSLChfromRGB((long double)RGB[2] / 255.0, (long double)RGB[1] / 255.0, (long double)RGB[0] / 255.0, H, S, L, C, h); // get "HSLC" from RGB
+
+    int s = WhichColorSector(round(H * 360.0)); // get sector and C and L categories for current pixel
+    int l = WhichLightnessCategory(round(L * 100.0));
+    int c = WhichChromaCategory(round(C * 100.0), s);
+
+    return (s * nb_lightness_categories + l) * nb_chroma_categories + c;
+}
+
+template <typename BinFunction>
+void SectoredMeansAccumulate(const cv::Mat &image, const int &nb_bins, const BinFunction &WhichBin, cv::Mat &quantized) // quantize image with the mean of each bin - one parallel pass with accumulators, then remap
+{
+    int linear[256]; // RGB values in linear space
+    SectoredMeansLinearTable(linear);
+
+    cv::Mat labels(image.rows, image.cols, CV_32SC1); // bin of each pixel, -1 = not used
+    const int nb_bands = NbRowBands(image); // each band has its own accumulators
+    std::vector<std::vector<int64_t>> sums(nb_bands, std::vector<int64_t>(nb_bins * 3, 0)); // sum of linear BGR values for each bin
+    std::vector<std::vector<int>> counts(nb_bands, std::vector<int>(nb_bins, 0)); // number of pixels in each bin
+
+    cv::parallel_for_(cv::Range(0, nb_bands), [&](const cv::Range &range) {
+        for (int band = range.start; band < range.end; band++)
+            for (int y = image.rows * band / nb_bands; y < image.rows * (band + 1) / nb_bands; y++) { // rows of band
+                const cv::Vec3b *RGB = image.ptr<cv::Vec3b>(y); // current row
+                int *label = labels.ptr<int>(y);
+                for (int x = 0; x < image.cols; x++) {
+                    int b = linear[RGB[x][0]]; // linear values
+                    int g = linear[RGB[x][1]];
+                    int r = linear[RGB[x][2]];
+                    if (((r * 4899 + g * 9617 + b * 1868 + (1 << 13)) >> 14) == 0) { // same as a black pixel in the gray mask of cv::cvtColor : not counted
+                        label[x] = -1;
+                        continue;
+                    }
+                    int bin = WhichBin(RGB[x]); // bin of current pixel
+                    label[x] = bin;
+                    sums[band][bin * 3] += b; // accumulate linear values
+                    sums[band][bin * 3 + 1] += g;
+                    sums[band][bin * 3 + 2] += r;
+                    counts[band][bin]++;
+                }
             }
+    });
+
+    std::vector<cv::Vec3b> colors(nb_bins); // mean color of each bin
+    for (int bin = 0; bin < nb_bins; bin++) {
+        int64_t sum[3] = {0, 0, 0}; // merge bands
+        int count = 0;
+        for (int band = 0; band < nb_bands; band++) {
+            for (int i = 0; i < 3; i++)
+                sum[i] += sums[band][bin * 3 + i];
+            count += counts[band][bin];
         }
+        if (count > 0) // does the bin contain any values ?
+            colors[bin] = SectoredMeansBinColor(sum, count);
     }
+
+    quantized = cv::Mat(image.rows, image.cols, CV_8UC3); // plot mean colors to quantized image
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; y++) {
+            const int *label = labels.ptr<int>(y);
+            cv::Vec3b *output = quantized.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < image.cols; x++)
+                output[x] = (label[x] < 0) ? cv::Vec3b(0, 0, 0) : colors[label[x]]; // not counted pixels stay black
+        }
+    });
 }
 
-void SectoredMeansSegmentationCategories(const cv::Mat &image, cv::Mat &quantized) // image segmentation by color sector mean (H from HSL)
+template <typename BinFunction>
+void SectoredMeansAccumulateColors(const std::vector<int> &colors, const std::vector<int> &counts, const int &nb_bins, const BinFunction &WhichBin,
+                                   std::vector<int> &quantized_colors) // same as SectoredMeansAccumulate on unique colors weighted by their number of pixels - same integer sums, same result
 {
-    quantized = cv::Mat::zeros(image.rows, image.cols, CV_8UC3); // init quantized image = black
-    cv::Mat mask_sector[nb_color_sectors][nb_lightness_categories][nb_chroma_categories]; // mask for each sector
-    for (int s = 0; s < nb_color_sectors; s++) // init these masks to black
-        for (int l = 0; l < nb_lightness_categories; l++)
-            for (int c = 0; c < nb_chroma_categories; c++)
-                mask_sector[s][l][c] = cv::Mat::zeros(image.rows, image.cols, CV_8UC3); // zero mask of same size than image
-
-    cv::Vec3b RGB;
-    long double H, S, L, C, h, r, g, b;
-    for (int x = 0; x < image.cols; x++) // parse image
-        for (int y = 0; y < image.rows; y++) {
-            RGB = image.at<cv::Vec3b>(y, x); // get current pixel
-            HSLChfromRGB((long double)RGB[2] / 255.0, (long double)RGB[1] / 255.0, (long double)RGB[0] / 255.0, H, S, L, C, h); // get "HSLC" from RGB
-
-            int s = WhichColorSector(round(H * 360.0)); // get sector and C and L categories for current pixel
-            int l = WhichLightnessCategory(round(L * 100.0));
-            int c = WhichChromaCategory(round(C * 100.0), s);
-            GammaCorrectionToSRGB(RGB[2] / 255.0, RGB[1] / 255.0, RGB[0] / 255.0, r, g, b); // RGB value in linear space => to compute mean
-            mask_sector[s][l][c].at<cv::Vec3b>(y, x) = cv::Vec3b(round(b * 255.0), round(g * 255.0), round(r * 255.0)); // copy pixel in the right sector mask
+    int linear[256]; // RGB values in linear space
+    SectoredMeansLinearTable(linear);
+
+    const int nb_values = colors.size();
+    std::vector<int> labels(nb_values); // bin of each color, -1 = not used
+    std::vector<int64_t> sums(nb_bins * 3, 0); // sum of linear BGR values for each bin
+    std::vector<int64_t> bin_counts(nb_bins, 0); // number of pixels in each bin
+    for (int i = 0; i < nb_values; i++) {
+        const cv::Vec3b RGB(colors[i] & 0xFF, (colors[i] >> 8) & 0xFF, (colors[i] >> 16) & 0xFF); // BGR like image pixels
+        int b = linear[RGB[0]]; // linear values
+        int g = linear[RGB[1]];
+        int r = linear[RGB[2]];
+        if (((r * 4899 + g * 9617 + b * 1868 + (1 << 13)) >> 14) == 0) { // black pixels are not counted
+            labels[i] = -1;
+            continue;
         }
+        int bin = WhichBin(RGB); // bin of current color
+        labels[i] = bin;
+        sums[bin * 3] += int64_t(b) * counts[i]; // accumulate linear values for all pixels of this color
+        sums[bin * 3 + 1] += int64_t(g) * counts[i];
+        sums[bin * 3 + 2] += int64_t(r) * counts[i];
+        bin_counts[bin] += counts[i];
+    }
 
-    int nb_pal = 0;
-    for (int s = 0; s < nb_color_sectors; s++) { // for each sector
-        for (int l = 0; l < nb_lightness_categories; l++)
-            for (int c = 0; c < nb_chroma_categories; c++) {
-                cv::Mat gray; // gray mask
-                cv::cvtColor(mask_sector[s][l][c], gray, cv::COLOR_BGR2GRAY); // countNonZero works only on a 1-dimension Mat
-                if (cv::countNonZero(gray) > 0) { // does the sector mask contain any values ?
-                    cv::Scalar mean = cv::mean(mask_sector[s][l][c], gray); // compute mean of entire sector
-                    GammaCorrectionFromSRGB(mean[2] / 255.0, mean[1] / 255.0, mean[0] / 255.0, r, g, b); // get rgb back from sRGB mean value
-                    quantized.setTo(cv::Vec3b(round(b * 255.0), round(g * 255.0), round(r * 255.0)), gray); // plot this mean color to quantized image from mask
-                    nb_pal++; // one more color in palette
-            }
+    std::vector<int> bin_colors(nb_bins, 0); // mean color of each bin as (R << 16 | G << 8 | B)
+    for (int bin = 0; bin < nb_bins; bin++)
+        if (bin_counts[bin] > 0) { // does the bin contain any values ?
+            cv::Vec3b color = SectoredMeansBinColor(&sums[bin * 3], bin_counts[bin]);
+            bin_colors[bin] = (color[2] << 16) | (color[1] << 8) | color[0];
         }
-    }
+
+    quantized_colors.resize(nb_values);
+    for (int i = 0; i < nb_values; i++)
+        quantized_colors[i] = (labels[i] < 0) ? 0 : bin_colors[labels[i]]; // not counted colors stay black
+}
+
+void SectoredMeansSegmentationLevels(const cv::Mat &image, const int &nb_levels, cv::Mat &quantized) // image segmentation by color sector mean (H from HSL)
+{
+    SectoredMeansAccumulate(image, nb_color_sectors * nb_levels * nb_levels, [&](const cv::Vec3b &RGB) {
+        return SectoredMeansLevelsBin(RGB, nb_levels);
+    }, quantized);
+}
+
+void SectoredMeansSegmentationCategories(const cv::Mat &image, cv::Mat &quantized) // image segmentation by color sector mean (H from HSL)
+{
+    SectoredMeansAccumulate(image, nb_color_sectors * nb_lightness_categories * nb_chroma_categories, [](const cv::Vec3b &RGB) {
+        return SectoredMeansCategoriesBin(RGB);
+    }, quantized);
+}
+
+void SectoredMeansColorsLevels(const std::vector<int> &colors, const std::vector<int> &counts, const int &nb_levels, std::vector<int> &quantized_colors) // sectored-means with levels on weighted unique colors
+{
+    SectoredMeansAccumulateColors(colors, counts, nb_color_sectors * nb_levels * nb_levels, [&](const cv::Vec3b &RGB) {
+        return SectoredMeansLevelsBin(RGB, nb_levels);
+    }, quantized_colors);
+}
+
+void SectoredMeansColorsCategories(const std::vector<int> &colors, const std::vector<int> &counts, std::vector<int> &quantized_colors) // sectored-means with categories on weighted unique colors
+{
+    SectoredMeansAccumulateColors(colors, counts, nb_color_sectors * nb_lightness_categories * nb_chroma_categories, [](const cv::Vec3b &RGB) {
+        return SectoredMeansCategoriesBin(RGB);
+    }, quantized_colors);
 }
 
 ////////////////////////////////////////////////////////////
@@ -161,20 +256,22 @@ void SectoredMeansSegmentationCategories(const cv::Mat &image, cv::Mat &quantize
 // source : http://aishack.in/tutorials/dominant-color/
 // works for any color space, because values are in range [0..1]
 // only implemented CIELab though
+// the tree is stored in a vector (children are indexes), so it is freed when the algorithm returns
+// the class map is 8, 16 or 32-bit depending on the number of classes needed
 
-std::vector<color_node*> GetLeaves(color_node *root)
+std::vector<int> GetLeaves(const std::vector<color_node> &tree) // indexes of leaves in tree, breadth-first order
 {
-    std::vector<color_node*> ret;
-    std::queue<color_node*> queue;
-    queue.push(root);
+    std::vector<int> ret;
+    std::queue<int> queue;
+    queue.push(0); // root
 
     while (queue.size() > 0) {
-        color_node *current = queue.front();
+        int current = queue.front();
         queue.pop();
 
-        if (current->left && current->right) {
-            queue.push(current->left);
-            queue.push(current->right);
+        if ((tree[current].left >= 0) and (tree[current].right >= 0)) {
+            queue.push(tree[current].left);
+            queue.push(tree[current].right);
             continue;
         }
 
@@ -184,273 +281,844 @@ std::vector<color_node*> GetLeaves(color_node *root)
     return ret;
 }
 
-std::vector<cv::Vec3f> GetDominantColors(color_node *root)
+std::vector<cv::Vec3f> GetDominantColors(const std::vector<color_node> &tree) // means of leaves
 {
-    std::vector<color_node*> leaves = GetLeaves(root);
+    std::vector<int> leaves = GetLeaves(tree);
     std::vector<cv::Vec3f> ret;
 
-    for (unsigned int i=0; i < leaves.size(); i++) {
-        cv::Mat mean = leaves[i]->mean;
-        ret.push_back(cv::Vec3f(mean.at<double>(0),
-                                mean.at<double>(1),
-                                mean.at<double>(2)));
-    }
+    for (unsigned int i = 0; i < leaves.size(); i++)
+        ret.push_back(cv::Vec3f(tree[leaves[i]].mean[0], tree[leaves[i]].mean[1], tree[leaves[i]].mean[2]));
 
     return ret;
 }
 
-int GetNextClassId(color_node *root) {
-    int maxid = 0;
-    std::queue<color_node*> queue;
-    queue.push(root);
+struct struct_moments { // moments of a class : enough to compute its mean and covariance
+    double sum[3]; // sum of values
+    double sum2[3][3]; // sum of products of values
+    double count; // number of pixels
+
+    void Reset() { // all moments to 0
+        count = 0;
+        for (int i = 0; i < 3; i++) {
+            sum[i] = 0;
+            for (int j = 0; j < 3; j++)
+                sum2[i][j] = 0;
+        }
+    }
 
-    while (queue.size() > 0) {
-        color_node* current = queue.front();
-        queue.pop();
+    void Add(const cv::Vec3f &color) { // accumulate one value
+        double c[3] = {color[0], color[1], color[2]};
+        for (int i = 0; i < 3; i++) {
+            sum[i] += c[i];
+            for (int j = i; j < 3; j++) // covariance is symmetric
+                sum2[i][j] += c[i] * c[j];
+        }
+        count++;
+    }
 
-        if (current->class_id > maxid)
-            maxid = current->class_id;
+    void Add(const cv::Vec3f &color, const double &weight) { // accumulate one value for several pixels
+        double c[3] = {color[0], color[1], color[2]};
+        for (int i = 0; i < 3; i++) {
+            sum[i] += weight * c[i];
+            for (int j = i; j < 3; j++) // covariance is symmetric
+                sum2[i][j] += weight * c[i] * c[j];
+        }
+        count += weight;
+    }
 
-        if (current->left != NULL)
-            queue.push(current->left);
+    void Merge(const struct_moments &moments) { // add moments of another part of the class
+        for (int i = 0; i < 3; i++) {
+            sum[i] += moments.sum[i];
+            for (int j = i; j < 3; j++)
+                sum2[i][j] += moments.sum2[i][j];
+        }
+        count += moments.count;
+    }
 
-        if (current->right)
-            queue.push(current->right);
+    void MeanCov(cv::Vec3d &mean, cv::Matx33d &cov) const { // compute mean and covariance from moments
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                cov(i, j) = sum2[std::min(i, j)][std::max(i, j)] - (sum[i] * sum[j]) / count; // same formula as cov - (mean * mean.t()) / pix_count
+        for (int i = 0; i < 3; i++)
+            mean[i] = sum[i] / count;
     }
+};
 
-    return maxid + 1;
-}
+const int eigen_band_rows = 32; // fixed band height : bands merged in the same order whatever the number of threads, so results don't depend on it
 
-void GetClassMeanCov(cv::Mat img, cv::Mat classes, color_node *node)
+template <typename T>
+void GetClassMeanCov(const cv::Mat &img, const cv::Mat &classes, color_node &node) // mean and covariance of a class - parallel over row bands
 {
-    const int width = img.cols;
-    const int height = img.rows;
-    const int class_id = node->class_id;
-
-    cv::Mat mean = cv::Mat(3, 1, CV_64FC1, cv::Scalar(0));
-    cv::Mat cov = cv::Mat(3, 3, CV_64FC1, cv::Scalar(0));
-
-    // start out with the average color
-    double pix_count = 0;
-    for (int y = 0; y < height; y++) {
-        cv::Vec3f* ptr = img.ptr<cv::Vec3f>(y);
-        char16_t* ptrClass = classes.ptr<char16_t>(y);
-        for (int x=0; x < width; x++) {
-            if (ptrClass[x] != class_id)
-                continue;
+    const T class_id = node.class_id;
+    const int nb_bands = (img.rows + eigen_band_rows - 1) / eigen_band_rows; // number of bands
+    std::vector<struct_moments> moments(nb_bands); // moments of each band
+
+    cv::parallel_for_(cv::Range(0, nb_bands), [&](const cv::Range &range) {
+        for (int band = range.start; band < range.end; band++) {
+            struct_moments &m = moments[band];
+            m.Reset();
+            for (int y = band * eigen_band_rows; y < std::min(img.rows, (band + 1) * eigen_band_rows); y++) {
+                const cv::Vec3f* ptr = img.ptr<cv::Vec3f>(y);
+                const T* ptr_class = classes.ptr<T>(y);
+                for (int x = 0; x < img.cols; x++)
+                    if (ptr_class[x] == class_id)
+                        m.Add(ptr[x]);
+            }
+        }
+    });
 
-            cv::Vec3f color = ptr[x];
-            cv::Mat scaled = cv::Mat(3, 1, CV_64FC1, cv::Scalar(0));
-            scaled.at<double>(0) = color[0];
-            scaled.at<double>(1) = color[1];
-            scaled.at<double>(2) = color[2];
+    struct_moments total; // merge bands in order
+    total.Reset();
+    for (int band = 0; band < nb_bands; band++)
+        total.Merge(moments[band]);
 
-            mean += scaled;
-            cov = cov + (scaled * scaled.t());
+    total.MeanCov(node.mean, node.cov); // node mean and covariance
+}
 
-            pix_count++;
+template <typename T>
+void PartitionClass(const cv::Mat &img, cv::Mat &classes, const color_node &node, color_node &left, color_node &right) // split a class in two along its main eigen vector, and compute children mean and covariance in the same pass
+{
+    const T class_id = node.class_id;
+    const T new_id_left = left.class_id;
+    const T new_id_right = right.class_id;
+
+    const cv::Vec3d &eig = node.eigen_vector; // main eigen vector, computed when node was created
+    const double comparison_value = eig[0] * node.mean[0] + eig[1] * node.mean[1] + eig[2] * node.mean[2]; // projection of mean
+
+    const int nb_bands = (img.rows + eigen_band_rows - 1) / eigen_band_rows; // number of bands
+    std::vector<struct_moments> moments_left(nb_bands), moments_right(nb_bands); // moments of children for each band
+
+    cv::parallel_for_(cv::Range(0, nb_bands), [&](const cv::Range &range) {
+        for (int band = range.start; band < range.end; band++) {
+            struct_moments &m_left = moments_left[band];
+            struct_moments &m_right = moments_right[band];
+            m_left.Reset();
+            m_right.Reset();
+            for (int y = band * eigen_band_rows; y < std::min(img.rows, (band + 1) * eigen_band_rows); y++) {
+                const cv::Vec3f* ptr = img.ptr<cv::Vec3f>(y);
+                T* ptr_class = classes.ptr<T>(y);
+                for (int x = 0; x < img.cols; x++) {
+                    if (ptr_class[x] != class_id)
+                        continue;
+
+                    const cv::Vec3f &color = ptr[x];
+                    double this_value = eig[0] * double(color[0]) + eig[1] * double(color[1]) + eig[2] * double(color[2]); // projection of value
+
+                    if (this_value <= comparison_value) {
+                        ptr_class[x] = new_id_left;
+                        m_left.Add(color);
+                    } else {
+                        ptr_class[x] = new_id_right;
+                        m_right.Add(color);
+                    }
+                }
+            }
         }
+    });
+
+    struct_moments total_left, total_right; // merge bands in order
+    total_left.Reset();
+    total_right.Reset();
+    for (int band = 0; band < nb_bands; band++) {
+        total_left.Merge(moments_left[band]);
+        total_right.Merge(moments_right[band]);
     }
 
-    cov = cov - (mean * mean.t()) / pix_count;
-    mean = mean / pix_count;
-
-    // node mean and covariance
-    node->mean = mean.clone();
-    node->cov = cov.clone();
-
-    return;
+    total_left.MeanCov(left.mean, left.cov); // children mean and covariance
+    total_right.MeanCov(right.mean, right.cov);
 }
 
-void PartitionClass(cv::Mat img, cv::Mat classes, char16_t nextid, color_node *node) {
-    const int width = img.cols;
-    const int height = img.rows;
-    const int class_id = node->class_id;
+template <typename T>
+cv::Mat GetQuantizedImage(const cv::Mat &classes, const std::vector<cv::Vec3f> &class_colors) // quantized image from class map and class id -> color table
+{
+    cv::Mat ret(classes.rows, classes.cols, CV_32FC3);
+
+    cv::parallel_for_(cv::Range(0, classes.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; y++) {
+            const T *ptr_class = classes.ptr<T>(y);
+            cv::Vec3f *ptr = ret.ptr<cv::Vec3f>(y);
+            for (int x = 0; x < classes.cols; x++)
+                ptr[x] = class_colors[ptr_class[x]];
+        }
+    });
 
-    const int new_id_left = nextid;
-    const int new_id_right = nextid + 1;
+    return ret;
+}
 
-    cv::Mat mean = node->mean;
-    cv::Mat cov = node->cov;
+void ComputeEigen(color_node &node) // compute and keep main eigen value and vector of node covariance
+{
     cv::Mat eigen_values, eigen_vectors;
-    cv::eigen(cov, eigen_values, eigen_vectors);
+    cv::eigen(node.cov, eigen_values, eigen_vectors);
 
-    cv::Mat eig = eigen_vectors.row(0);
-    cv::Mat comparison_value = eig * mean;
+    node.eigen_value = eigen_values.at<double>(0);
+    if (std::isnan(node.eigen_value)) // empty class : never split it
+        node.eigen_value = -1;
+    for (int i = 0; i < 3; i++)
+        node.eigen_vector[i] = eigen_vectors.at<double>(0, i);
+}
 
-    node->left = new color_node();
-    node->right = new color_node();
+color_node NewColorNode(const int &class_id) // leaf with no values yet
+{
+    color_node node;
+    node.class_id = class_id;
+    node.eigen_value = -1;
+    node.left = -1;
+    node.right = -1;
+    return node;
+}
 
-    node->left->class_id = new_id_left;
-    node->right->class_id = new_id_right;
+template <typename T>
+std::vector<cv::Vec3f> DominantColorsEigen(const cv::Mat &img, const int &nb_colors, const int &type, cv::Mat &quantized) // Eigen algorithm with class map of type T
+{
+    std::vector<color_node> tree; // all nodes, root is at index 0
+    tree.reserve(2 * nb_colors - 1); // final size : never reallocated
+    tree.push_back(NewColorNode(1)); // root
+
+    cv::Mat classes = cv::Mat(img.rows, img.cols, type, cv::Scalar(1)); // all pixels in class 1
+    GetClassMeanCov<T>(img, classes, tree[0]);
+    ComputeEigen(tree[0]);
+
+    auto CompareEigenValues = [&tree](const int &a, const int &b) { // order of nodes in priority queue : greatest eigen value first, then lowest class id
+        if (tree[a].eigen_value != tree[b].eigen_value)
+            return tree[a].eigen_value < tree[b].eigen_value;
+        return tree[a].class_id > tree[b].class_id;
+    };
+    std::priority_queue<int, std::vector<int>, decltype(CompareEigenValues)> leaves(CompareEigenValues); // leaves to split, greatest eigen value on top
+    leaves.push(0);
+    int next_id = 2; // next class id to give
 
-    // start out with average color
-    for (int y = 0; y < height; y++) {
-        cv::Vec3f* ptr = img.ptr<cv::Vec3f>(y);
-        char16_t* ptr_class = classes.ptr<char16_t>(y);
-        for (int x = 0; x < width; x++) {
-            if (ptr_class[x] != class_id)
-                continue;
+    for (int i = 0; i < nb_colors - 1; i++) {
+        int next = leaves.top(); // leaf with greatest eigen value
+        leaves.pop();
+        tree[next].left = tree.size(); // two new leaves
+        tree.push_back(NewColorNode(next_id));
+        tree[next].right = tree.size();
+        tree.push_back(NewColorNode(next_id + 1));
+        next_id += 2;
+        PartitionClass<T>(img, classes, tree[next], tree[tree[next].left], tree[tree[next].right]); // also computes children mean and covariance
+        ComputeEigen(tree[tree[next].left]); // once for each new leaf
+        ComputeEigen(tree[tree[next].right]);
+        leaves.push(tree[next].left);
+        leaves.push(tree[next].right);
+    }
+    ProfileCount("eigen splits", nb_colors - 1);
 
-            cv::Vec3f color = ptr[x];
-            cv::Mat scaled = cv::Mat(3, 1,
-                                  CV_64FC1,
-                                  cv::Scalar(0));
+    std::vector<cv::Vec3f> class_colors(next_id); // class id -> leaf color
+    std::vector<int> leaf_indexes = GetLeaves(tree);
+    for (unsigned int i = 0; i < leaf_indexes.size(); i++) {
+        const color_node &leaf = tree[leaf_indexes[i]];
+        class_colors[leaf.class_id] = cv::Vec3f(leaf.mean[0], leaf.mean[1], leaf.mean[2]);
+    }
 
-            scaled.at<double>(0) = color[0];
-            scaled.at<double>(1) = color[1];
-            scaled.at<double>(2) = color[2];
+    quantized = GetQuantizedImage<T>(classes, class_colors); // the quantized image has values in range [0..1]
+    return GetDominantColors(tree);
+}
 
-            cv::Mat this_value = eig * scaled;
+std::vector<cv::Vec3f> DominantColorsEigenCIELab(const cv::Mat &img, const int &nb_colors, cv::Mat &quantized) // Eigen algorithm
+{
+    // CIELab values are in range [0..1]
 
-            if (this_value.at<double>(0, 0) <= comparison_value.at<double>(0, 0)) {
-                ptr_class[x] = new_id_left;
-            } else {
-                ptr_class[x] = new_id_right;
-            }
-        }
-    }
-    return;
+    const int nb_classes = 2 * nb_colors; // class ids are in [1..2 * nb_colors - 1]
+    if (nb_classes <= 256) // smallest class map possible
+        return DominantColorsEigen<uchar>(img, nb_colors, CV_8UC1, quantized);
+    else if (nb_classes <= 65536)
+        return DominantColorsEigen<ushort>(img, nb_colors, CV_16UC1, quantized);
+    else
+        return DominantColorsEigen<int>(img, nb_colors, CV_32SC1, quantized);
 }
 
-cv::Mat GetQuantizedImage(cv::Mat classes, color_node *root) {
-    std::vector<color_node*> leaves = GetLeaves(root);
-
-    const int height = classes.rows;
-    const int width = classes.cols;
-    cv::Mat ret(height, width, CV_32FC3, cv::Scalar(0));
+const int eigen_chunk_values = 4096; // fixed chunk of weighted values : chunks merged in the same order whatever the number of threads
 
-    for (int y = 0; y < height; y++) {
-        char16_t *ptr_class = classes.ptr<char16_t>(y);
-        cv::Vec3f *ptr = ret.ptr<cv::Vec3f>(y);
-        for (int x = 0; x < width; x++) {
-            char16_t pixel_class = ptr_class[x];
-            for (unsigned int i = 0; i < leaves.size(); i++) {
-                if (leaves[i]->class_id == pixel_class) {
-                    ptr[x] = cv::Vec3f(leaves[i]->mean.at<double>(0),
-                                       leaves[i]->mean.at<double>(1),
-                                       leaves[i]->mean.at<double>(2));
+void PartitionClassWeighted(const std::vector<cv::Vec3f> &values, const std::vector<int> &weights, std::vector<int> &classes,
+                            const color_node &node, color_node &left, color_node &right) // same as PartitionClass on weighted values
+{
+    const cv::Vec3d &eig = node.eigen_vector; // main eigen vector, computed when node was created
+    const double comparison_value = eig[0] * node.mean[0] + eig[1] * node.mean[1] + eig[2] * node.mean[2]; // projection of mean
+
+    const int nb_values = values.size();
+    const int nb_chunks = (nb_values + eigen_chunk_values - 1) / eigen_chunk_values; // number of chunks
+    std::vector<struct_moments> moments_left(nb_chunks), moments_right(nb_chunks); // moments of children for each chunk
+
+    cv::parallel_for_(cv::Range(0, nb_chunks), [&](const cv::Range &range) {
+        for (int chunk = range.start; chunk < range.end; chunk++) {
+            struct_moments &m_left = moments_left[chunk];
+            struct_moments &m_right = moments_right[chunk];
+            m_left.Reset();
+            m_right.Reset();
+            for (int i = chunk * eigen_chunk_values; i < std::min(nb_values, (chunk + 1) * eigen_chunk_values); i++) {
+                if (classes[i] != node.class_id)
+                    continue;
+
+                const cv::Vec3f &color = values[i];
+                double this_value = eig[0] * double(color[0]) + eig[1] * double(color[1]) + eig[2] * double(color[2]); // projection of value
+
+                if (this_value <= comparison_value) {
+                    classes[i] = left.class_id;
+                    m_left.Add(color, weights[i]);
+                } else {
+                    classes[i] = right.class_id;
+                    m_right.Add(color, weights[i]);
                 }
             }
         }
+    });
+
+    struct_moments total_left, total_right; // merge chunks in order
+    total_left.Reset();
+    total_right.Reset();
+    for (int chunk = 0; chunk < nb_chunks; chunk++) {
+        total_left.Merge(moments_left[chunk]);
+        total_right.Merge(moments_right[chunk]);
     }
 
-    return ret;
+    total_left.MeanCov(left.mean, left.cov); // children mean and covariance
+    total_right.MeanCov(right.mean, right.cov);
 }
 
-color_node* GetMaxEigenValueNode(color_node *current) {
-    double max_eigen = -1;
-    cv::Mat eigen_values, eigen_vectors;
+std::vector<cv::Vec3f> DominantColorsEigenCIELabColors(const std::vector<int> &colors, const std::vector<int> &counts, const int &nb_colors,
+                                                       std::vector<int> &quantized_colors) // Eigen algorithm on weighted unique colors
+{
+    // unique colors to CIELab
+    const int nb_values = colors.size();
+    cv::Mat rgb(1, nb_values, CV_8UC3); // unique colors as a one-row BGR image
+    for (int i = 0; i < nb_values; i++)
+        rgb.at<cv::Vec3b>(0, i) = cv::Vec3b(colors[i] & 0xFF, (colors[i] >> 8) & 0xFF, (colors[i] >> 16) & 0xFF);
+    ProfileStage stage("Lab conversion");
+    cv::Mat lab = ImgRGBtoLab(rgb); // CIELab values in [0..1]
+    stage.Stop();
+    std::vector<cv::Vec3f> values(lab.ptr<cv::Vec3f>(0), lab.ptr<cv::Vec3f>(0) + nb_values);
+    lab.release();
+
+    std::vector<color_node> tree; // all nodes, root is at index 0
+    tree.reserve(2 * nb_colors - 1); // final size : never reallocated
+    tree.push_back(NewColorNode(1)); // root
+
+    std::vector<int> classes(nb_values, 1); // all values in class 1
+    struct_moments root; // root mean and covariance
+    root.Reset();
+    for (int i = 0; i < nb_values; i++)
+        root.Add(values[i], counts[i]);
+    root.MeanCov(tree[0].mean, tree[0].cov);
+    ComputeEigen(tree[0]);
+
+    auto CompareEigenValues = [&tree](const int &a, const int &b) { // same order as DominantColorsEigen
+        if (tree[a].eigen_value != tree[b].eigen_value)
+            return tree[a].eigen_value < tree[b].eigen_value;
+        return tree[a].class_id > tree[b].class_id;
+    };
+    std::priority_queue<int, std::vector<int>, decltype(CompareEigenValues)> leaves(CompareEigenValues); // leaves to split, greatest eigen value on top
+    leaves.push(0);
+    int next_id = 2; // next class id to give
 
-    std::queue<color_node*> queue;
-    queue.push(current);
+    for (int i = 0; i < nb_colors - 1; i++) {
+        int next = leaves.top(); // leaf with greatest eigen value
+        leaves.pop();
+        tree[next].left = tree.size(); // two new leaves
+        tree.push_back(NewColorNode(next_id));
+        tree[next].right = tree.size();
+        tree.push_back(NewColorNode(next_id + 1));
+        next_id += 2;
+        PartitionClassWeighted(values, counts, classes, tree[next], tree[tree[next].left], tree[tree[next].right]); // also computes children mean and covariance
+        ComputeEigen(tree[tree[next].left]); // once for each new leaf
+        ComputeEigen(tree[tree[next].right]);
+        leaves.push(tree[next].left);
+        leaves.push(tree[next].right);
+    }
+    ProfileCount("eigen splits", nb_colors - 1);
+
+    // class id -> leaf color in RGB, converted once per leaf
+    std::vector<int> leaf_indexes = GetLeaves(tree);
+    cv::Mat leaves_lab(1, int(leaf_indexes.size()), CV_32FC3); // leaf colors as a one-row CIELab image
+    for (unsigned int i = 0; i < leaf_indexes.size(); i++) {
+        const color_node &leaf = tree[leaf_indexes[i]];
+        leaves_lab.at<cv::Vec3f>(0, i) = cv::Vec3f(leaf.mean[0], leaf.mean[1], leaf.mean[2]);
+    }
+    stage.Next("Lab conversion");
+    cv::Mat leaves_rgb = ImgLabToRGB(leaves_lab);
+    stage.Stop();
+    std::vector<int> class_colors(next_id, 0); // class id -> leaf color as (R << 16 | G << 8 | B)
+    for (unsigned int i = 0; i < leaf_indexes.size(); i++) {
+        const cv::Vec3b &color = leaves_rgb.at<cv::Vec3b>(0, i);
+        class_colors[tree[leaf_indexes[i]].class_id] = (color[2] << 16) | (color[1] << 8) | color[0];
+    }
 
-    color_node *ret = current;
-    if (!current->left && !current->right)
-        return current;
+    quantized_colors.resize(nb_values);
+    for (int i = 0; i < nb_values; i++)
+        quantized_colors[i] = class_colors[classes[i]];
 
-    while (queue.size() > 0) {
-        color_node *node = queue.front();
-        queue.pop();
+    return GetDominantColors(tree);
+}
 
-        if (node->left && node->right) {
-            queue.push(node->left);
-            queue.push(node->right);
-            continue;
-        }
+////////////////////////////////////////////////////////////
+////                K_means algorithm
+////////////////////////////////////////////////////////////
 
-        cv::eigen(node->cov, eigen_values, eigen_vectors);
-        double val = eigen_values.at<double>(0);
-        if (val > max_eigen) {
-            max_eigen = val;
-            ret = node;
-        }
-    }
+static bool KMeansBoundsEnabled = true; // K-means skips distances with triangle inequality bounds
 
-    return ret;
+void EnableKMeansBounds(const bool &enable) // use (or not) Hamerly bounds in K-means - same result, only speed changes
+{
+    KMeansBoundsEnabled = enable;
 }
 
-std::vector<cv::Vec3f> DominantColorsEigenCIELab(const cv::Mat &img, const int &nb_colors, cv::Mat &quantized) // Eigen algorithm
+bool IsKMeansBoundsEnabled() // are Hamerly bounds used in K-means ?
 {
-    // CIELab values are in range [0..1]
+    return KMeansBoundsEnabled;
+}
+
+long double WeightedKMeans(const std::vector<cv::Vec3f> &values, const std::vector<int> &weights, const int &nb_clusters, const std::vector<cv::Vec3f> &seeds,
+                           const int &max_iterations, const double &epsilon, std::vector<int> &labels, std::vector<cv::Vec3f> &centers) // one weighted K-means run (K-means++ init after seed centers + Lloyd iterations) - returns compactness
+{
+    const int nb_values = values.size();
+    cv::RNG &rng = cv::theRNG(); // same random generator as cv::kmeans
+
+    // K-means++ initialization : each value has a probability proportional to weight * squared distance to nearest center
+    centers.assign(nb_clusters, cv::Vec3f(0, 0, 0));
+    std::vector<double> distances(nb_values); // weighted squared distance to nearest center
+    std::vector<double> cumulative(nb_values); // cumulative sum of distances
+    const int nb_seeds = std::min(int(seeds.size()), nb_clusters); // first centers are given : warm start
+    const bool bounds = KMeansBoundsEnabled;
+    labels.assign(nb_values, 0); // with bounds : nearest center of each value, already known by K-means++
+    std::vector<float> nearest_distances, second_distances; // with bounds : squared distance to nearest and second nearest center
+    if (bounds) {
+        nearest_distances.assign(nb_values, FLT_MAX);
+        second_distances.assign(nb_values, FLT_MAX);
+    }
 
-    const int width = img.cols;
-    const int height = img.rows;
+    double total = 0;
+    int index;
+    if (nb_seeds == 0) { // cold start
+        for (int i = 0; i < nb_values; i++) { // first center : probability proportional to weight
+            total += weights[i];
+            cumulative[i] = total;
+        }
+        index = std::upper_bound(cumulative.begin(), cumulative.end(), rng.uniform(0.0, total)) - cumulative.begin(); // random weighted value
+        centers[0] = values[std::min(index, nb_values - 1)];
+
+        cv::parallel_for_(cv::Range(0, nb_values), [&](const cv::Range &range) { // distances to first center
+            for (int i = range.start; i < range.end; i++) {
+                float d = cv::normL2Sqr<float, float>(&values[i][0], &centers[0][0], 3);
+                distances[i] = weights[i] * d;
+                if (bounds)
+                    nearest_distances[i] = d;
+            }
+        });
+    }
+    else { // seed centers
+        std::copy(seeds.begin(), seeds.begin() + nb_seeds, centers.begin());
+        cv::parallel_for_(cv::Range(0, nb_values), [&](const cv::Range &range) { // distances to nearest seed
+            for (int i = range.start; i < range.end; i++) {
+                float best = FLT_MAX, second = FLT_MAX;
+                for (int k = 0; k < nb_seeds; k++) {
+                    float d = cv::normL2Sqr<float, float>(&values[i][0], &centers[k][0], 3);
+                    if (d < best) {
+                        second = best;
+                        best = d;
+                        labels[i] = k;
+                    }
+                    else if (d < second)
+                        second = d;
+                }
+                distances[i] = weights[i] * double(best);
+                if (bounds) {
+                    nearest_distances[i] = best;
+                    second_distances[i] = second;
+                }
+            }
+        });
+    }
+
+    for (int k = std::max(1, nb_seeds); k < nb_clusters; k++) { // next centers
+        total = 0;
+        for (int i = 0; i < nb_values; i++) {
+            total += distances[i];
+            cumulative[i] = total;
+        }
+        if (total > 0)
+            index = std::upper_bound(cumulative.begin(), cumulative.end(), rng.uniform(0.0, total)) - cumulative.begin(); // random value far from centers
+        else
+            index = rng.uniform(0, nb_values); // all values are already centers
+        centers[k] = values[std::min(index, nb_values - 1)];
+
+        cv::parallel_for_(cv::Range(0, nb_values), [&](const cv::Range &range) { // update distances to nearest center
+            for (int i = range.start; i < range.end; i++) {
+                float d = cv::normL2Sqr<float, float>(&values[i][0], &centers[k][0], 3);
+                distances[i] = std::min(distances[i], weights[i] * double(d));
+                if (bounds) { // same order and comparison as the full search : same nearest center
+                    if (d < nearest_distances[i]) {
+                        second_distances[i] = nearest_distances[i];
+                        nearest_distances[i] = d;
+                        labels[i] = k;
+                    }
+                    else if (d < second_distances[i])
+                        second_distances[i] = d;
+                }
+            }
+        });
+    }
 
-    cv::Mat classes = cv::Mat(height, width, CV_16UC1, cv::Scalar(1));
-    color_node *root = new color_node();
+    // Lloyd iterations on weighted values
+    // Hamerly bounds : a value keeps its center without computing the other distances if it is nearer than half the distance between its center
+    // and the nearest other one, or than a lower bound of its distance to all other centers - bounds are tested with a small margin for float rounding,
+    // so labels and centers are exactly the same as with the full search
+    const double margin = 1.0 + 1e-5; // relative margin on bounds
+    std::vector<double> lower; // lower bound of distance to all centers except own center - exact after K-means++
+    if (bounds) {
+        lower.resize(nb_values);
+        for (int i = 0; i < nb_values; i++)
+            lower[i] = (second_distances[i] == FLT_MAX) ? 0 : std::sqrt(double(second_distances[i])); // one center : no bound
+        std::vector<float>().swap(nearest_distances); // not needed anymore
+        std::vector<float>().swap(second_distances);
+    }
+    std::vector<double> half_gaps(nb_clusters); // half distance from each center to nearest other center
+    std::vector<double> moves(nb_clusters); // distance each center moved in last iteration
+    std::vector<cv::Vec3d> sums(nb_clusters); // weighted sums of values for each cluster
+    std::vector<double> cluster_weights(nb_clusters); // total weight of each cluster
+    long double compactness = 0;
+    int nb_iterations = 0; // for profile counter
+    std::atomic<long long> nb_distances(0); // distances computed, for profile counter
+
+    for (int iteration = 0; iteration < max_iterations; iteration++) {
+        nb_iterations++;
+
+        if (bounds) // distances between centers
+            for (int k = 0; k < nb_clusters; k++) {
+                float nearest = FLT_MAX;
+                for (int j = 0; j < nb_clusters; j++)
+                    if (j != k)
+                        nearest = std::min(nearest, cv::normL2Sqr<float, float>(&centers[k][0], &centers[j][0], 3));
+                half_gaps[k] = (nb_clusters > 1) ? 0.5 * std::sqrt(double(nearest)) : DBL_MAX; // one center : nothing to compare
+            }
 
-    root->class_id = 1;
-    root->left = NULL;
-    root->right = NULL;
+        // assign each value to nearest center
+        cv::parallel_for_(cv::Range(0, nb_values), [&](const cv::Range &range) {
+            long long count = 0; // distances computed in this range
+            for (int i = range.start; i < range.end; i++) {
+                if (bounds) { // is current center surely the nearest ?
+                    float d = cv::normL2Sqr<float, float>(&values[i][0], &centers[labels[i]][0], 3); // squared distance to current center
+                    count++;
+                    if (std::sqrt(double(d)) * margin < std::max(half_gaps[labels[i]], lower[i])) {
+                        distances[i] = d;
+                        continue;
+                    }
+                }
+                float best = FLT_MAX; // nearest center distance
+                float second = FLT_MAX; // second nearest center distance
+                for (int k = 0; k < nb_clusters; k++) {
+                    float d = cv::normL2Sqr<float, float>(&values[i][0], &centers[k][0], 3); // squared euclidian distance
+                    if (d < best) {
+                        second = best;
+                        best = d;
+                        labels[i] = k;
+                    }
+                    else if (d < second)
+                        second = d;
+                }
+                count += nb_clusters;
+                distances[i] = best;
+                if (bounds)
+                    lower[i] = std::sqrt(double(second));
+            }
+            nb_distances += count;
+        });
+        compactness = 0;
+        for (int i = 0; i < nb_values; i++) // in order : same sum at each run
+            compactness += (long double)(weights[i]) * distances[i];
+
+        // new centers = weighted means
+        std::fill(sums.begin(), sums.end(), cv::Vec3d(0, 0, 0));
+        std::fill(cluster_weights.begin(), cluster_weights.end(), 0);
+        for (int i = 0; i < nb_values; i++) {
+            for (int c = 0; c < 3; c++)
+                sums[labels[i]][c] += double(values[i][c]) * weights[i];
+            cluster_weights[labels[i]] += weights[i];
+        }
 
-    color_node *next = root;
-    GetClassMeanCov(img, classes, root);
+        double max_shift = 0; // maximum squared move of a center
+        for (int k = 0; k < nb_clusters; k++) {
+            cv::Vec3f center;
+            if (cluster_weights[k] > 0) // weighted mean
+                center = cv::Vec3f(sums[k][0] / cluster_weights[k], sums[k][1] / cluster_weights[k], sums[k][2] / cluster_weights[k]);
+            else { // empty cluster : take the value farthest from its center
+                int farthest = std::max_element(distances.begin(), distances.end()) - distances.begin();
+                center = values[farthest];
+                distances[farthest] = 0; // don't take it twice
+            }
+            double shift = cv::normL2Sqr<float, float>(&center[0], &centers[k][0], 3);
+            moves[k] = std::sqrt(shift);
+            max_shift = std::max(max_shift, shift);
+            centers[k] = center;
+        }
 
-    for (int i = 0; i < nb_colors - 1; i++) {
-        next = GetMaxEigenValueNode(root);
-        PartitionClass(img, classes, GetNextClassId(root), next);
-        GetClassMeanCov(img, classes, next->left);
-        GetClassMeanCov(img, classes, next->right);
+        if (max_shift <= epsilon * epsilon) // same ending criteria as cv::kmeans
+            break;
+
+        if (bounds) { // other centers may have come nearer by at most their biggest move
+            int farthest = std::max_element(moves.begin(), moves.end()) - moves.begin(); // center that moved most
+            double second_move = 0; // biggest move of the other centers
+            for (int k = 0; k < nb_clusters; k++)
+                if (k != farthest)
+                    second_move = std::max(second_move, moves[k]);
+            cv::parallel_for_(cv::Range(0, nb_values), [&](const cv::Range &range) {
+                for (int i = range.start; i < range.end; i++)
+                    lower[i] -= (labels[i] == farthest) ? second_move : moves[farthest];
+            });
+        }
     }
 
-    std::vector<cv::Vec3f> colors = GetDominantColors(root);
-    quantized = GetQuantizedImage(classes, root); // the quantized image has values in range [0..1]
-    return colors;
+    ProfileCount("k-means iterations", nb_iterations);
+    ProfileCount("k-means distances", nb_distances);
+    return compactness;
 }
 
-////////////////////////////////////////////////////////////
-////                K_means algorithm
-////////////////////////////////////////////////////////////
+long double WeightedKMeansAttempts(const std::vector<cv::Vec3f> &values, const std::vector<int> &weights, const int &nb_clusters, const std::vector<cv::Vec3f> &seeds,
+                                   const int &nb_attempts, const double &epsilon, std::vector<int> &labels, std::vector<cv::Vec3f> &centers) // best of several weighted K-means runs, 100 iterations max - returns compactness
+{
+    std::vector<int> attempt_labels;
+    std::vector<cv::Vec3f> attempt_centers;
+    long double best_compactness = -1;
+    for (int attempt = 0; attempt < nb_attempts; attempt++) {
+        long double compactness = WeightedKMeans(values, weights, nb_clusters, seeds, 100, epsilon, attempt_labels, attempt_centers);
+        if ((best_compactness < 0) or (compactness < best_compactness)) { // keep best attempt
+            best_compactness = compactness;
+            labels.swap(attempt_labels);
+            centers.swap(attempt_centers);
+        }
+    }
+    ProfileCount("k-means attempts", nb_attempts);
+    return best_compactness;
+}
 
 cv::Mat DominantColorsKMeansRGB(const cv::Mat &source, const int &nb_clusters, cv::Mat1f &dominant_colors) // Dominant colors with K-means from RGB image
 {
-    const unsigned int data_size = source.rows * source.cols; // size of source
-    cv::Mat data = source.reshape(1, data_size); // reshape the source to a single line
-    data.convertTo(data, CV_32F); // floats needed by K-means
+    const int data_size = source.rows * source.cols; // size of source
+    std::vector<cv::Vec3f> values(data_size); // floats needed by K-means
+    for (int y = 0; y < source.rows; y++) {
+        const cv::Vec3b *row = source.ptr<cv::Vec3b>(y); // BGR source pixels
+        for (int x = 0; x < source.cols; x++)
+            values[y * source.cols + x] = cv::Vec3f(row[x][0], row[x][1], row[x][2]);
+    }
 
     std::vector<int> indices; // color clusters
-    cv::Mat1f colors; // colors output
-    cv::kmeans(data, nb_clusters, indices, cv::TermCriteria(cv::TermCriteria::EPS+cv::TermCriteria::COUNT, 100, 1.0),
-               100, cv::KMEANS_PP_CENTERS, colors); // ending criterias : 100 iterations and epsilon=1.0
-
-    for (unsigned int i = 0 ; i < data_size ; i++ ) { // replace colors in image data
-        data.at<float>(i, 0) = colors(indices[i], 0);
-        data.at<float>(i, 1) = colors(indices[i], 1);
-        data.at<float>(i, 2) = colors(indices[i], 2);
+    std::vector<cv::Vec3f> centers; // colors output
+    WeightedKMeansAttempts(values, std::vector<int>(data_size, 1), std::min(nb_clusters, data_size), std::vector<cv::Vec3f>(),
+                           100, 1.0, indices, centers); // ending criterias : 100 iterations and epsilon=1.0
+
+    cv::Mat output_image(source.rows, source.cols, CV_8UC3); // BGR image
+    for (int y = 0; y < source.rows; y++) { // replace colors in image data
+        cv::Vec3b *output = output_image.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < source.cols; x++) {
+            const cv::Vec3f &center = centers[indices[y * source.cols + x]];
+            output[x] = cv::Vec3b(cv::saturate_cast<uchar>(center[0]), cv::saturate_cast<uchar>(center[1]), cv::saturate_cast<uchar>(center[2]));
+        }
     }
 
-    cv::Mat output_image = data.reshape(3, source.rows); // RGB channels needed for output
-    output_image.convertTo(output_image, CV_8UC3); // BGR image
-
-    dominant_colors = colors; // save colors clusters
+    dominant_colors = cv::Mat1f(centers.size(), 3); // save colors clusters
+    for (unsigned int k = 0; k < centers.size(); k++)
+        for (int c = 0; c < 3; c++)
+            dominant_colors(k, c) = centers[k][c];
 
     return output_image; // return quantized image
 }
 
-cv::Mat DominantColorsKMeansCIELAB(const cv::Mat &source, const int &nb_clusters, cv::Mat1f &dominant_colors) // Dominant colors with K-means in CIELAB space from RGB image
+cv::Mat DominantColorsKMeansCIELAB(const cv::Mat &source, const int &nb_clusters, cv::Mat1f &dominant_colors, const cv::Mat1f &initial_centers) // Dominant colors with K-means in CIELAB space from RGB image
 {
+    ProfileStage stage("Lab conversion");
     cv::Mat temp = ImgRGBtoLab(source);
+    stage.Stop();
 
-    const unsigned int data_size = source.rows * source.cols; // size of source
-    cv::Mat1f data = temp.reshape(1, data_size); // reshape CIELab data to a single line
+    const int data_size = source.rows * source.cols; // size of source
+    std::vector<cv::Vec3f> values(temp.begin<cv::Vec3f>(), temp.end<cv::Vec3f>()); // CIELab data as a single line
+    temp.release();
 
+    // same ending criterias as before : 100 K-means++ attempts, 100 iterations and epsilon=1.0
+    const int nb_centers = std::min(nb_clusters, data_size); // can't find more clusters than pixels
+    std::vector<cv::Vec3f> seeds; // warm start : initial centers, the missing ones are found with K-means++
+    for (int k = 0; k < std::min(initial_centers.rows, nb_centers); k++)
+        seeds.push_back(cv::Vec3f(initial_centers(k, 0), initial_centers(k, 1), initial_centers(k, 2)));
     std::vector<int> indices; // color clusters
-    cv::Mat1f colors; // colors output
-    cv::kmeans(data, nb_clusters, indices, cv::TermCriteria(cv::TermCriteria::EPS+cv::TermCriteria::COUNT, 100, 1.0),
-               100, cv::KMEANS_PP_CENTERS, colors); // k-means on CIELab data, ending criterias : 100 iterations and epsilon=1.0
+    std::vector<cv::Vec3f> centers; // colors output
+    WeightedKMeansAttempts(values, std::vector<int>(data_size, 1), nb_centers, seeds, seeds.empty() ? 100 : 1, 1.0, indices, centers); // seeded run is already near the solution
+
+    cv::Mat centers_lab(1, nb_centers, CV_32FC3, &centers[0]); // centers as a one-row CIELab image
+    stage.Next("Lab conversion");
+    cv::Mat centers_rgb = ImgLabToRGB(centers_lab); // converted once per cluster, not once per pixel
+    stage.Stop();
+
+    cv::Mat output_image(source.rows, source.cols, CV_8UC3); // replace colors in image data
+    for (int y = 0; y < source.rows; y++) {
+        cv::Vec3b *output = output_image.ptr<cv::Vec3b>(y); // BGR quantized pixels
+        for (int x = 0; x < source.cols; x++)
+            output[x] = centers_rgb.at<cv::Vec3b>(0, indices[y * source.cols + x]);
+    }
+
+    dominant_colors = cv::Mat1f(nb_centers, 3); // save colors clusters in CIELab color space (all values in range [0..1])
+    for (int k = 0; k < nb_centers; k++)
+        for (int c = 0; c < 3; c++)
+            dominant_colors(k, c) = centers[k][c];
 
-    for (unsigned int i = 0 ; i < data_size ; i++ ) { // replace colors in CIELab data
-        data.at<float>(i, 0) = colors(indices[i], 0);
-        data.at<float>(i, 1) = colors(indices[i], 1);
-        data.at<float>(i, 2) = colors(indices[i], 2);
+    return output_image; // return quantized image
+}
+
+void DominantColorsKMeansCIELABColors(const std::vector<int> &colors, const std::vector<int> &counts, const int &nb_clusters,
+                                      cv::Mat1f &dominant_colors, std::vector<int> &quantized_colors, const cv::Mat1f &initial_centers) // weighted K-means on unique colors in CIELAB space
+{
+    // unique colors to CIELab
+    const int nb_values = colors.size();
+    cv::Mat rgb(1, nb_values, CV_8UC3); // unique colors as a one-row BGR image
+    for (int i = 0; i < nb_values; i++)
+        rgb.at<cv::Vec3b>(0, i) = cv::Vec3b(colors[i] & 0xFF, (colors[i] >> 8) & 0xFF, (colors[i] >> 16) & 0xFF);
+    ProfileStage stage("Lab conversion");
+    cv::Mat lab = ImgRGBtoLab(rgb); // CIELab values in [0..1]
+    stage.Stop();
+    std::vector<cv::Vec3f> values(lab.ptr<cv::Vec3f>(0), lab.ptr<cv::Vec3f>(0) + nb_values);
+    ProfileCount("k-means unique colors", nb_values);
+
+    // weighted K-means : same number of attempts and ending criteria as DominantColorsKMeansCIELAB
+    const int nb_centers = std::min(nb_clusters, nb_values); // can't find more clusters than colors
+    std::vector<cv::Vec3f> seeds; // warm start : initial centers, the missing ones are found with K-means++
+    for (int k = 0; k < std::min(initial_centers.rows, nb_centers); k++)
+        seeds.push_back(cv::Vec3f(initial_centers(k, 0), initial_centers(k, 1), initial_centers(k, 2)));
+    std::vector<int> best_labels;
+    std::vector<cv::Vec3f> best_centers;
+    WeightedKMeansAttempts(values, counts, nb_centers, seeds, seeds.empty() ? 100 : 1, 1.0, best_labels, best_centers); // seeded run is already near the solution
+
+    // clusters to RGB
+    cv::Mat centers_lab(1, nb_centers, CV_32FC3, &best_centers[0]); // centers as a one-row CIELab image
+    cv::Mat centers_rgb = ImgLabToRGB(centers_lab); // converted once per cluster, not once per pixel
+
+    dominant_colors = cv::Mat1f(nb_centers, 3); // save colors clusters in CIELab color space (all values in range [0..1])
+    for (int k = 0; k < nb_centers; k++)
+        for (int c = 0; c < 3; c++)
+            dominant_colors(k, c) = best_centers[k][c];
+
+    quantized_colors.resize(nb_values); // each unique color gets the color of its cluster
+    for (int i = 0; i < nb_values; i++) {
+        const cv::Vec3b &center = centers_rgb.at<cv::Vec3b>(0, best_labels[i]);
+        quantized_colors[i] = (center[2] << 16) | (center[1] << 8) | center[0];
     }
+}
 
-    cv::Mat output_image = data.reshape(3, source.rows); // 3 channels needed for output
-    cv::Mat output_temp = ImgLabToRGB(output_image);
+cv::Mat DominantColorsKMeansCIELABUnique(const cv::Mat &source, const int &nb_clusters, cv::Mat1f &dominant_colors, const cv::Mat1f &initial_centers) // Dominant colors with weighted K-means on unique colors in CIELAB space from RGB image
+{
+    // unique colors of image with their number of pixels
+    std::vector<int> colors, counts;
+    CountRGBUniqueValues(source, colors, counts);
+
+    std::vector<int> quantized_colors; // color of cluster of each unique color
+    DominantColorsKMeansCIELABColors(colors, counts, nb_clusters, dominant_colors, quantized_colors, initial_centers);
+
+    // quantized image : each pixel gets the color of its cluster
+    cv::Mat output_image(source.rows, source.cols, CV_8UC3);
+    for (int y = 0; y < source.rows; y++) {
+        const cv::Vec3b *row = source.ptr<cv::Vec3b>(y); // BGR source pixels
+        cv::Vec3b *output = output_image.ptr<cv::Vec3b>(y); // BGR quantized pixels
+        for (int x = 0; x < source.cols; x++) {
+            int color = (row[x][2] << 16) | (row[x][1] << 8) | row[x][0];
+            int index = std::lower_bound(colors.begin(), colors.end(), color) - colors.begin(); // unique colors are sorted
+            int quantized_color = quantized_colors[index];
+            output[x] = cv::Vec3b(quantized_color & 0xFF, (quantized_color >> 8) & 0xFF, (quantized_color >> 16) & 0xFF);
+        }
+    }
 
-    dominant_colors = colors; // save colors clusters in CIELab color space (all values in range [0..1])
-    return output_temp; // return quantized image
+    return output_image; // return quantized image
+}
+
+std::vector<cv::Vec3f> RandomPixelsLab(const cv::Mat &source, const int &nb_pixels, cv::RNG &rng) // CIELab values of random pixels of RGB image
+{
+    cv::Mat batch(1, nb_pixels, CV_8UC3); // random pixels as a one-row BGR image
+    const int size = source.rows * source.cols;
+    for (int i = 0; i < nb_pixels; i++) {
+        int pixel = rng.uniform(0, size); // with replacement
+        batch.at<cv::Vec3b>(0, i) = source.at<cv::Vec3b>(pixel / source.cols, pixel % source.cols);
+    }
+    cv::Mat lab = ImgRGBtoLab(batch); // only the batch is converted
+    return std::vector<cv::Vec3f>(lab.ptr<cv::Vec3f>(0), lab.ptr<cv::Vec3f>(0) + nb_pixels);
+}
+
+int NearestCenter(const cv::Vec3f &value, const std::vector<cv::Vec3f> &centers) // index of nearest center
+{
+    int nearest = 0;
+    float best = FLT_MAX; // nearest center distance
+    for (unsigned int k = 0; k < centers.size(); k++) {
+        float d = cv::normL2Sqr<float, float>(&value[0], &centers[k][0], 3); // squared euclidian distance
+        if (d < best) {
+            best = d;
+            nearest = k;
+        }
+    }
+    return nearest;
+}
+
+cv::Mat DominantColorsKMeansCIELABMiniBatch(const cv::Mat &source, const int &nb_clusters, const int &batch_size, const double &tolerance,
+                                            cv::Mat1f &dominant_colors, const cv::Mat1f &initial_centers) // Dominant colors with mini-batch K-means in CIELAB space from RGB image
+{
+    cv::RNG &rng = cv::theRNG(); // same random generator as cv::kmeans
+    const int nb_pixels = source.rows * source.cols;
+    const int nb_samples = std::max(1, std::min(batch_size, nb_pixels)); // pixels in each batch
+    const int nb_batches_max = 1000; // ending criteria if tolerance is never reached
+
+    // initialization : K-means++ on a sample of 3 batches, after initial centers if any
+    ProfileStage stage("Lab conversion");
+    std::vector<cv::Vec3f> values = RandomPixelsLab(source, std::min(3 * nb_samples, nb_pixels), rng);
+    stage.Stop();
+    const int nb_centers = std::min(nb_clusters, int(values.size())); // can't find more clusters than values
+    std::vector<cv::Vec3f> seeds; // warm start
+    for (int k = 0; k < std::min(initial_centers.rows, nb_centers); k++)
+        seeds.push_back(cv::Vec3f(initial_centers(k, 0), initial_centers(k, 1), initial_centers(k, 2)));
+    std::vector<int> weights(values.size(), 1); // sampled pixels all weigh the same
+    std::vector<int> labels;
+    std::vector<cv::Vec3f> centers;
+    WeightedKMeans(values, weights, nb_centers, seeds, 0, 0, labels, centers); // no Lloyd iteration : the batches do the work
+    ProfileCount("k-means attempts", 1);
+
+    // mini-batches : each center moves towards its pixels with a learning rate of 1 / number of pixels it has learned from
+    std::vector<double> cluster_counts(nb_centers, 0); // pixels each center has learned from
+    std::vector<int> batch_labels(nb_samples); // nearest center of each batch pixel
+    int nb_batches = 0; // for profile counter
+    for (int batch = 0; batch < nb_batches_max; batch++) {
+        nb_batches++;
+        std::vector<cv::Vec3f> batch_values = RandomPixelsLab(source, nb_samples, rng); // new random pixels
+
+        for (int i = 0; i < nb_samples; i++) // assign each pixel to nearest center, centers don't move yet
+            batch_labels[i] = NearestCenter(batch_values[i], centers);
+
+        std::vector<cv::Vec3f> previous = centers; // centers before this batch
+        for (int i = 0; i < nb_samples; i++) { // gradient step for each pixel
+            const int k = batch_labels[i];
+            cluster_counts[k]++;
+            const float rate = 1.0 / cluster_counts[k]; // per-center learning rate
+            centers[k] += rate * (batch_values[i] - centers[k]);
+        }
+
+        double max_shift = 0; // maximum squared move of a center
+        for (int k = 0; k < nb_centers; k++)
+            max_shift = std::max(max_shift, double(cv::normL2Sqr<float, float>(&centers[k][0], &previous[k][0], 3)));
+        if (max_shift <= tolerance * tolerance) // centers don't move anymore
+            break;
+    }
+    ProfileCount("k-means batches", nb_batches);
+
+    // final assignment of all pixels, converted to CIELab one row at a time : no full-size CIELab copy
+    stage.Next("assignment");
+    cv::Mat centers_lab(1, nb_centers, CV_32FC3, &centers[0]); // centers as a one-row CIELab image
+    cv::Mat centers_rgb = ImgLabToRGB(centers_lab); // converted once per cluster, not once per pixel
+    cv::Mat output_image(source.rows, source.cols, CV_8UC3);
+    cv::parallel_for_(cv::Range(0, source.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; y++) {
+            cv::Mat lab = ImgRGBtoLab(source.row(y)); // CIELab row
+            const cv::Vec3f *row = lab.ptr<cv::Vec3f>(0);
+            cv::Vec3b *output = output_image.ptr<cv::Vec3b>(y); // BGR quantized pixels
+            for (int x = 0; x < source.cols; x++)
+                output[x] = centers_rgb.at<cv::Vec3b>(0, NearestCenter(row[x], centers));
+        }
+    });
+
+    dominant_colors = cv::Mat1f(nb_centers, 3); // save colors clusters in CIELab color space (all values in range [0..1])
+    for (int k = 0; k < nb_centers; k++)
+        for (int c = 0; c < 3; c++)
+            dominant_colors(k, c) = centers[k][c];
+
+    return output_image; // return quantized image
 }
 
 ////////////////////////////////////////////////////////////
@@ -529,57 +1197,99 @@ MeanShift::MeanShift(const float &s, const float &r) // Constructor for spatial
     hr = r;
 }
 
-void MeanShift::MeanShiftFilteringCIELab(cv::Mat &Img) // Mean Shift Filtering
+float SquaredLimit(const double &limit, const bool &strict) // smallest float s with sqrtf(s) >= limit (> limit if strict) : sqrtf(d) < limit <=> d < s, exactly
 {
-    int ROWS = Img.rows;			// Get row number
-    int COLS = Img.cols;			// Get column number
-    split(Img, IMGChannels);		// Split Lab color
+    auto Reached = [&](const float &value) { // is limit reached for this squared value ?
+        return strict ? (double(sqrtf(value)) > limit) : (double(sqrtf(value)) >= limit);
+    };
 
-    Point5D PtCur;					// Current point
-    Point5D PtPrev;					// Previous point
-    Point5D PtSum;					// Sum vector of the shift vector
-    Point5D Pt;
-    int Left;						// Left boundary
-    int Right;						// Right boundary
-    int Top;						// Top boundary
-    int Bottom;						// Bottom boundary
-    int NumPts;						// number of points in a hypersphere
-    int step;
+    float s = float(limit * limit); // near the answer
+    while ((s > 0) and (Reached(s)) and (Reached(nextafterf(s, 0)))) // go down while still reached
+        s = nextafterf(s, 0);
+    while (!Reached(s)) // go up until reached
+        s = nextafterf(s, INFINITY);
 
-    for(int i = 0; i < ROWS; i++) {
-        for(int j = 0; j < COLS; j++) {
-            Left = (j - hs) > 0 ? (j - hs) : 0;						// Get Left boundary of the filter
-            Right = (j + hs) < COLS ? (j + hs) : COLS;				// Get Right boundary of the filter
-            Top = (i - hs) > 0 ? (i - hs) : 0;						// Get Top boundary of the filter
-            Bottom = (i + hs) < ROWS ? (i + hs) : ROWS;				// Get Bottom boundary of the filter
-            PtCur.MSPOint5DSet(i, j, (float)IMGChannels[0].at<float>(i, j), (float)IMGChannels[1].at<float>(i, j), (float)IMGChannels[2].at<float>(i, j)); // Set current point
-            step = 0;				// count the times
-            do {
-                PtPrev.MSPoint5DCopy(PtCur);						// Set the original point and previous one
-                PtSum.MSPOint5DSet(0, 0, 0, 0, 0);					// Initial Sum vector
-                NumPts = 0;											// Count number of points that satisfy the bandwidths
-                for(int hx = Top; hx < Bottom; hx++) {
-                    for(int hy = Left; hy < Right; hy++) {
-                        Pt.MSPOint5DSet(hx, hy, (float)IMGChannels[0].at<float>(hx, hy), (float)IMGChannels[1].at<float>(hx, hy), (float)IMGChannels[2].at<float>(hx, hy)); // Set point in the spatial bandwidth
-                        if (Pt.MSPoint5DColorDistance(PtCur) < hr) { // Check it satisfied color bandwidth or not
-                            PtSum.MSPoint5DAccum(Pt);				// Accumulate the point to Sum vector
-                            NumPts++;								// Count
+    return s;
+}
+
+inline float MSSquaredColorDistance(const cv::Vec3f &p1, const cv::Vec3f &p2) // same as squared Point5D::MSPoint5DColorDistance, without sqrtf and powf
+{
+    float l = double(p1[0]) * 100.0 - double(p2[0]) * 100.0; // same double computation and float rounding as original
+    float a = double(p1[1]) * 127.0 - double(p2[1]) * 127.0;
+    float b = double(p1[2]) * 127.0 - double(p2[2]) * 127.0;
+    return l * l + a * a + b * b;
+}
+
+void MeanShift::MeanShiftFilteringCIELab(cv::Mat &Img) // Mean Shift Filtering
+{
+    ProfileStage stage("mean-shift filtering");
+    const int ROWS = Img.rows;		// Get row number
+    const int COLS = Img.cols;		// Get column number
+    const cv::Mat source = Img.clone(); // interleaved Lab values read by all threads, results written to Img
+
+    // distances are compared squared : limits are converted once, with exactly the same results as sqrtf comparisons
+    const float hr_squared = SquaredLimit(hr, false); // color distance < hr
+    const float tol_color_squared = SquaredLimit(MS_MEAN_SHIFT_TOL_COLOR, true); // color distance > tolerance
+    const float tol_spatial_squared = SquaredLimit(MS_MEAN_SHIFT_TOL_SPATIAL, true); // spatial distance > tolerance
+    std::atomic<long long> nb_steps(0); // total of convergence steps, for profile counter
+
+    cv::parallel_for_(cv::Range(0, ROWS), [&](const cv::Range &range) { // each pixel is independent : rows are shared between threads
+        long long range_steps = 0; // convergence steps in this range
+        for(int i = range.start; i < range.end; i++) {
+            cv::Vec3f *output = Img.ptr<cv::Vec3f>(i); // result row
+            for(int j = 0; j < COLS; j++) {
+                const int Left = (j - hs) > 0 ? (j - hs) : 0;					// Get Left boundary of the filter
+                const int Right = (j + hs) < COLS ? (j + hs) : COLS;			// Get Right boundary of the filter
+                const int Top = (i - hs) > 0 ? (i - hs) : 0;					// Get Top boundary of the filter
+                const int Bottom = (i + hs) < ROWS ? (i + hs) : ROWS;			// Get Bottom boundary of the filter
+
+                float cur_x = i; // Current point
+                float cur_y = j;
+                cv::Vec3f cur = source.at<cv::Vec3f>(i, j);
+                int step = 0;				// count the times
+                bool moving;
+                do {
+                    const float prev_x = cur_x; // previous point
+                    const float prev_y = cur_y;
+                    const cv::Vec3f prev = cur;
+                    float sum_x = 0, sum_y = 0, sum_l = 0, sum_a = 0, sum_b = 0; // Sum vector of the shift vector
+                    int NumPts = 0;			// Count number of points that satisfy the bandwidths
+                    for(int hx = Top; hx < Bottom; hx++) {
+                        const cv::Vec3f *row = source.ptr<cv::Vec3f>(hx); // neighbors row
+                        for(int hy = Left; hy < Right; hy++) {
+                            if (MSSquaredColorDistance(row[hy], cur) < hr_squared) { // Check it satisfied color bandwidth or not
+                                sum_x += hx;	// Accumulate the point to Sum vector
+                                sum_y += hy;
+                                sum_l += row[hy][0];
+                                sum_a += row[hy][1];
+                                sum_b += row[hy][2];
+                                NumPts++;		// Count
+                            }
                         }
                     }
-                }
-                PtSum.MSPoint5DScale(1.0 / NumPts);					// Scale Sum vector to average vector
-                PtCur.MSPoint5DCopy(PtSum);							// Get new origin point
-                step++;												// One time end
-            } while((PtCur.MSPoint5DColorDistance(PtPrev) > MS_MEAN_SHIFT_TOL_COLOR) && (PtCur.MSPoint5DSpatialDistance(PtPrev) > MS_MEAN_SHIFT_TOL_SPATIAL)
-                        && (step < MS_MAX_NUM_CONVERGENCE_STEPS)); // filter iteration to end
-
-            Img.at<cv::Vec3f>(i, j) = cv::Vec3f(PtCur.l, PtCur.a, PtCur.b); // Copy result to image
+                    const float scale = 1.0 / NumPts; // Scale Sum vector to average vector
+                    cur_x = sum_x * scale;	// Get new origin point
+                    cur_y = sum_y * scale;
+                    cur = cv::Vec3f(sum_l * scale, sum_a * scale, sum_b * scale);
+                    step++;					// One time end
+
+                    const float dx = cur_x - prev_x;
+                    const float dy = cur_y - prev_y;
+                    moving = (MSSquaredColorDistance(cur, prev) >= tol_color_squared) and (dx * dx + dy * dy >= tol_spatial_squared);
+                } while (moving and (step < MS_MAX_NUM_CONVERGENCE_STEPS)); // filter iteration to end
+
+                output[j] = cur; // Copy result to image
+                range_steps += step;
+            }
         }
-    }
+        nb_steps += range_steps;
+    });
+    ProfileCount("mean-shift convergence steps", nb_steps);
 }
 
 void MeanShift::MeanShiftSegmentationCIELab(cv::Mat &Img) // Mean Shift Segmentation
 {
+    ProfileStage stage("mean-shift segmentation");
     int ROWS = Img.rows;			// Get row number
     int COLS = Img.cols;			// Get column number
 
@@ -651,6 +1361,8 @@ void MeanShift::MeanShiftSegmentationCIELab(cv::Mat &Img) // Mean Shift Segmenta
         }
     }
 
+    ProfileCount("mean-shift regions", label + 1);
+
     // Get result image from Mode array
     for(int i = 0; i < ROWS; i++) {
         for(int j = 0; j < COLS; j++) {
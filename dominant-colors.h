@@ -88,28 +88,48 @@ int WhichChromaCategory(const int &C, const int &colorSector); // get the Chroma
 
 void SectoredMeansSegmentationLevels(const cv::Mat &image, const int &nb_chroma, cv::Mat &quantized); // image segmentation by color sector mean (H from HSL)
 void SectoredMeansSegmentationCategories(const cv::Mat &image, cv::Mat &quantized); // image segmentation by color sector mean (H from HSL)
+// same on unique colors (R << 16 | G << 8 | B) weighted by their number of pixels : quantized color of each unique color, same result as on the image
+void SectoredMeansColorsLevels(const std::vector<int> &colors, const std::vector<int> &counts, const int &nb_levels, std::vector<int> &quantized_colors);
+void SectoredMeansColorsCategories(const std::vector<int> &colors, const std::vector<int> &counts, std::vector<int> &quantized_colors);
 
 ///////////////////////////////////////////////
 ////                 Eigen
 ///////////////////////////////////////////////
 
-typedef struct color_node { // for eigen algorithm
-    cv::Mat     mean;
-    cv::Mat     cov;
-    int       class_id;
+typedef struct color_node { // for eigen algorithm - nodes are stored in a vector
+    cv::Vec3d   mean; // mean of class values
+    cv::Matx33d cov; // covariance of class values
+    int         class_id;
+    double      eigen_value; // main eigen value of cov - computed once when node is created
+    cv::Vec3d   eigen_vector; // main eigen vector of cov
 
-    color_node *left;
-    color_node *right;
+    int         left; // index of children in tree vector, -1 = leaf
+    int         right;
 } color_node;
 
 std::vector<cv::Vec3f> DominantColorsEigenCIELab(const cv::Mat &img, const int &nb_colors, cv::Mat &quantized); // Eigen algorithm with CIELab values in range [0..1]
+std::vector<cv::Vec3f> DominantColorsEigenCIELabColors(const std::vector<int> &colors, const std::vector<int> &counts, const int &nb_colors,
+                                                       std::vector<int> &quantized_colors); // Eigen algorithm on unique colors weighted by their number of pixels - quantized color of each unique color
 
 ///////////////////////////////////////////////
 ////                K-means
 ///////////////////////////////////////////////
 
+// native K-means (K-means++ init, Lloyd iterations) with Hamerly bounds : distances that can't change the nearest center are skipped, labels and centers are the same as without bounds
+void EnableKMeansBounds(const bool &enable); // use (or not) Hamerly bounds in K-means - on by default
+bool IsKMeansBoundsEnabled(); // are Hamerly bounds used in K-means ?
 cv::Mat DominantColorsKMeansRGB(const cv::Mat &image, const int &cluster_number, cv::Mat1f &dominant_colors); // Dominant colors with K-means from RGB image
-cv::Mat DominantColorsKMeansCIELAB(const cv::Mat &image, const int &cluster_number, cv::Mat1f &dominant_colors); // Dominant colors with K-means in CIELAB space from RGB image
+// CIELab K-means : initial_centers (one per row, like dominant_colors) = warm start, e.g. centers of previous frame of a video - one attempt from them instead of 100 K-means++ attempts
+cv::Mat DominantColorsKMeansCIELAB(const cv::Mat &image, const int &cluster_number, cv::Mat1f &dominant_colors,
+                                   const cv::Mat1f &initial_centers = cv::Mat1f()); // Dominant colors with K-means in CIELAB space from RGB image
+cv::Mat DominantColorsKMeansCIELABUnique(const cv::Mat &image, const int &cluster_number, cv::Mat1f &dominant_colors,
+                                         const cv::Mat1f &initial_centers = cv::Mat1f()); // Dominant colors with weighted K-means on unique colors (color, count) in CIELAB space from RGB image
+void DominantColorsKMeansCIELABColors(const std::vector<int> &colors, const std::vector<int> &counts, const int &cluster_number,
+                                      cv::Mat1f &dominant_colors, std::vector<int> &quantized_colors,
+                                      const cv::Mat1f &initial_centers = cv::Mat1f()); // same on a histogram of unique colors - quantized color of each unique color
+// mini-batch K-means : centers learn from batches of batch_size random pixels until they move less than tolerance, then one pass assigns all pixels - no full-size CIELab copy
+cv::Mat DominantColorsKMeansCIELABMiniBatch(const cv::Mat &image, const int &cluster_number, const int &batch_size, const double &tolerance,
+                                            cv::Mat1f &dominant_colors, const cv::Mat1f &initial_centers = cv::Mat1f()); // Dominant colors with mini-batch K-means in CIELAB space from RGB image
 
 ///////////////////////////////////////////////
 ////              Mean-Shift
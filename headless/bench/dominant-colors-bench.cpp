@@ -0,0 +1,415 @@
+/*#-------------------------------------------------
+#
+#     Dominant colors benchmark - no Qt
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - quantization algorithms and pipeline stages
+#   - images from examples folder + synthetic sizes
+#   - several thread counts
+#   - wall time, pixels/s and peak memory as JSON
+#
+#-------------------------------------------------*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "opencv2/opencv.hpp"
+
+#include "dominant-colors.h"
+#include "dominant-colors-pipeline.h"
+#include "mat-image-tools.h"
+#include "color-names.h"
+#include "color-spaces.h"
+
+///////////////////////////////////////////////////////////
+//// Peak memory
+///////////////////////////////////////////////////////////
+
+bool ResetPeakMemory() // reset peak memory of process - returns false if not possible, peak is then the peak since program start
+{
+#if defined(__linux__)
+    std::ofstream clear("/proc/self/clear_refs"); // "5" resets peak resident set size (Linux 4.0+)
+    if (!clear)
+        return false;
+    clear << "5";
+    clear.close();
+    return clear.good();
+#else
+    return false;
+#endif
+}
+
+double PeakMemoryMB() // peak resident memory of process in MB
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status"); // VmHWM is the peak resident set size, and can be reset
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::atof(line.substr(6).c_str()) / 1024.0; // value in kB
+    struct rusage usage; // no /proc : peak since program start
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // kB on Linux
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / 1048576.0; // bytes
+#elif defined(__APPLE__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1048576.0; // bytes on macOS
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // kB
+#endif
+}
+
+///////////////////////////////////////////////////////////
+//// Benchmarks
+///////////////////////////////////////////////////////////
+
+struct struct_bench_image { // image to benchmark, with inputs of stages computed once and not timed
+    std::string name; // filename, or "synthetic-xMP"
+    double synthetic_megapixels; // size of synthetic image - 0 = image file
+    cv::Mat image; // BGR image - loaded or generated just before its benchmarks
+    cv::Mat lab; // CIELab image - computed on first use
+    cv::Mat filtered; // mean-shift filtered CIELab image - computed on first use
+};
+
+struct struct_benchmark { // one benchmark
+    std::string name; // name in JSON
+    double max_megapixels; // slow algorithms are not run on bigger images unless asked - 0 = no limit
+    std::function<void(struct_bench_image &)> prepare; // compute untimed inputs
+    std::function<void(struct_bench_image &)> run; // timed code
+};
+
+const cv::Mat &LabImage(struct_bench_image &bench) // CIELab version of benchmark image
+{
+    if (bench.lab.empty())
+        bench.lab = ImgRGBtoLab(bench.image);
+    return bench.lab;
+}
+
+std::vector<struct_benchmark> Benchmarks(const struct_color_names &color_names) // list of benchmarks
+{
+    const struct_dominant_params params = struct_dominant_params(); // default values, like in GUI
+    auto none = [](struct_bench_image &) {}; // nothing to prepare
+    auto lab = [](struct_bench_image &bench) { LabImage(bench); }; // CIELab input
+
+    return {
+        {"sectored-means-categories", 0, none, [](struct_bench_image &bench) {
+            cv::Mat quantized;
+            SectoredMeansSegmentationCategories(bench.image, quantized);
+        }},
+        {"sectored-means-levels", 0, none, [params](struct_bench_image &bench) {
+            cv::Mat quantized;
+            SectoredMeansSegmentationLevels(bench.image, params.sectored_means_nb_levels, quantized);
+        }},
+        {"eigen-vectors", 0, lab, [params](struct_bench_image &bench) {
+            cv::Mat quantized;
+            DominantColorsEigenCIELab(bench.lab, params.nb_colors, quantized);
+        }},
+        {"k-means-unique-colors", 0, none, [params](struct_bench_image &bench) {
+            cv::Mat1f colors;
+            DominantColorsKMeansCIELABUnique(bench.image, params.nb_colors, colors);
+        }},
+        {"k-means-all-pixels", 16, none, [params](struct_bench_image &bench) {
+            cv::Mat1f colors;
+            DominantColorsKMeansCIELAB(bench.image, params.nb_colors, colors);
+        }},
+        {"k-means-unique-colors-64", 0, none, [](struct_bench_image &bench) { // high K : Hamerly bounds skip most distances
+            cv::Mat1f colors;
+            DominantColorsKMeansCIELABUnique(bench.image, 64, colors);
+        }},
+        {"k-means-mini-batch", 0, none, [params](struct_bench_image &bench) {
+            cv::Mat1f colors;
+            DominantColorsKMeansCIELABMiniBatch(bench.image, params.nb_colors, params.kmeans_batch_size, params.kmeans_tolerance, colors);
+        }},
+        {"mean-shift-filtering", 2, lab, [params](struct_bench_image &bench) {
+            cv::Mat temp = bench.lab.clone(); // filtering is done in place
+            MeanShift MSProc(params.mean_shift_spatial, params.mean_shift_color);
+            MSProc.MeanShiftFilteringCIELab(temp);
+        }},
+        {"mean-shift-segmentation", 2, [params](struct_bench_image &bench) {
+            if (bench.filtered.empty()) { // segmentation works on filtered image, like in pipeline
+                bench.filtered = LabImage(bench).clone();
+                MeanShift MSProc(params.mean_shift_spatial, params.mean_shift_color);
+                MSProc.MeanShiftFilteringCIELab(bench.filtered);
+            }
+        }, [params](struct_bench_image &bench) {
+            cv::Mat temp = bench.filtered.clone(); // segmentation is done in place
+            MeanShift MSProc(params.mean_shift_spatial, params.mean_shift_color);
+            MSProc.MeanShiftSegmentationCIELab(temp);
+        }},
+        {"rgb-to-lab", 0, none, [](struct_bench_image &bench) {
+            ImgRGBtoLab(bench.image);
+        }},
+        {"lab-to-rgb", 0, lab, [](struct_bench_image &bench) {
+            ImgLabToRGB(bench.lab);
+        }},
+        {"count-unique-colors", 0, none, [](struct_bench_image &bench) {
+            std::vector<int> colors, counts;
+            CountRGBUniqueValues(bench.image, colors, counts);
+        }},
+        {"pipeline", 0, none, [params, &color_names](struct_bench_image &bench) {
+            struct_dominant_result result;
+            ComputeDominantColors(bench.image, params, color_names, result);
+        }},
+        {"pipeline-tiled", 0, none, [params, &color_names](struct_bench_image &bench) {
+            struct_dominant_result result;
+            ComputeDominantColorsTiled(bench.image.rows, bench.image.cols, MatBandReader(bench.image), TiledBandRows(bench.image.cols, tiled_memory_default),
+                                       params, color_names, result);
+        }}
+    };
+}
+
+cv::Mat SyntheticImage(const double &megapixels) // photo-like image : smooth color areas with noise, always the same for a given size
+{
+    const int width = round(sqrt(megapixels * 1000000.0 * 3.0 / 2.0)); // 3:2 aspect ratio like most cameras
+    const int height = round(megapixels * 1000000.0 / width);
+
+    cv::RNG rng(0x0ddba11); // fixed seed : same image for each run
+    cv::Mat small(24, 36, CV_8UC3); // random colors...
+    rng.fill(small, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat image;
+    cv::resize(small, image, cv::Size(width, height), 0, 0, cv::INTER_CUBIC); // ... smoothly interpolated
+    cv::Mat noise(height, width, CV_8SC3); // signed : noise is added and subtracted
+    rng.fill(noise, cv::RNG::NORMAL, 0, 6); // sensor-like noise : many unique colors
+    cv::add(image, noise, image, cv::noArray(), CV_8UC3);
+    return image;
+}
+
+///////////////////////////////////////////////////////////
+//// Command-line and JSON
+///////////////////////////////////////////////////////////
+
+std::string JSONString(const std::string &text) // text as JSON string - UTF-8 bytes are kept
+{
+    std::string json = "\"";
+    for (unsigned int i = 0; i < text.size(); i++) {
+        unsigned char c = text[i];
+        if ((c == '"') or (c == '\\')) // escape special chars
+            json += std::string("\\") + char(c);
+        else if (c < 32) { // control chars
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        }
+        else
+            json += char(c);
+    }
+    return json + "\"";
+}
+
+std::vector<double> ParseList(const std::string &list) // comma-separated numbers
+{
+    std::vector<double> values;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            values.push_back(std::atof(item.c_str()));
+    return values;
+}
+
+void ShowUsage(const std::string &program) // command-line help
+{
+    std::cerr << "Usage: " << program << " [options]" << std::endl
+              << "Options:" << std::endl
+              << "  --examples DIR        folder of images to benchmark (default examples)" << std::endl
+              << "  --no-examples         only synthetic images" << std::endl
+              << "  --sizes LIST          synthetic image sizes in megapixels (default 1,4,16,50) - empty = none" << std::endl
+              << "  --threads LIST        thread counts (default 1 and number of CPUs)" << std::endl
+              << "  --repeat N            timed runs for each measure, median is reported (default 3)" << std::endl
+              << "  --only LIST           only these benchmarks, comma-separated names" << std::endl
+              << "  --no-limits           also run slow algorithms on big images" << std::endl
+              << "  --no-lab-cube         do not use the RGB to CIELab lookup cube (saves 192 MB, slower)" << std::endl
+              << "  --no-kmeans-bounds    K-means without Hamerly bounds (same results, slower)" << std::endl
+              << "  -o, --output FILE     JSON results file (default standard output)" << std::endl
+              << "Benchmarks: sectored-means-categories, sectored-means-levels, eigen-vectors, k-means-unique-colors, k-means-unique-colors-64, k-means-all-pixels," << std::endl
+              << "            k-means-mini-batch, mean-shift-filtering, mean-shift-segmentation, rgb-to-lab, lab-to-rgb, count-unique-colors, pipeline," << std::endl
+              << "            pipeline-tiled" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string examples_dir = "examples"; // images folder - empty = none
+    std::vector<double> sizes = {1, 4, 16, 50}; // synthetic images sizes in megapixels
+    std::vector<double> threads = {1, double(cv::getNumberOfCPUs())}; // thread counts
+    int repeat = 3; // timed runs for each measure
+    std::string only; // comma-separated benchmark names - empty = all
+    bool limits = true; // size limits for slow algorithms
+    bool lab_cube = true; // RGB to CIELab cube
+    bool kmeans_bounds = true; // K-means with Hamerly bounds
+    std::string output; // JSON file - empty = standard output
+
+    for (int i = 1; i < argc; i++) { // parse command-line
+        std::string arg = argv[i]; // current argument
+        bool has_value = (i + 1 < argc); // is there another argument after this one ?
+
+        if ((arg == "-h") or (arg == "--help")) {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+        else if ((arg == "--examples") and (has_value))
+            examples_dir = argv[++i];
+        else if (arg == "--no-examples")
+            examples_dir = "";
+        else if ((arg == "--sizes") and (has_value))
+            sizes = ParseList(argv[++i]);
+        else if ((arg == "--threads") and (has_value))
+            threads = ParseList(argv[++i]);
+        else if ((arg == "--repeat") and (has_value))
+            repeat = std::max(1, std::atoi(argv[++i]));
+        else if ((arg == "--only") and (has_value))
+            only = "," + std::string(argv[++i]) + ",";
+        else if (arg == "--no-limits")
+            limits = false;
+        else if (arg == "--no-lab-cube")
+            lab_cube = false;
+        else if (arg == "--no-kmeans-bounds")
+            kmeans_bounds = false;
+        else if (((arg == "-o") or (arg == "--output")) and (has_value))
+            output = argv[++i];
+        else {
+            std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+            ShowUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::sort(threads.begin(), threads.end()); // same thread count only once
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+    EnableRGBtoLabCube(lab_cube);
+    EnableKMeansBounds(kmeans_bounds);
+    struct_color_names color_names; // color names for pipeline
+    LoadBuiltinColorNames(color_names);
+
+    // images : examples folder then synthetic sizes - only listed here, each one is loaded or generated just before its benchmarks
+    std::vector<struct_bench_image> images;
+    if (!examples_dir.empty()) {
+        std::vector<cv::String> files;
+        cv::glob(examples_dir + "/*", files, false); // all files, sorted
+        for (unsigned int f = 0; f < files.size(); f++)
+            if (cv::haveImageReader(files[f])) // not an image = skipped
+                images.push_back({files[f], 0, cv::Mat(), cv::Mat(), cv::Mat()});
+        if (images.empty())
+            std::cerr << "Warning: no image found in " << examples_dir << std::endl;
+    }
+    for (unsigned int s = 0; s < sizes.size(); s++)
+        if (sizes[s] > 0) {
+            std::ostringstream name;
+            name << "synthetic-" << sizes[s] << "MP";
+            images.push_back({name.str(), sizes[s], cv::Mat(), cv::Mat(), cv::Mat()});
+        }
+
+    // warm-up : RGB to CIELab cube and color names are built once for the whole program, not measured
+    cv::Mat warm = SyntheticImage(0.01);
+    ImgRGBtoLab(warm);
+    struct_dominant_result warm_result;
+    ComputeDominantColors(warm, struct_dominant_params(), color_names, warm_result);
+
+    std::ostringstream json; // results
+    json << "{" << std::endl
+         << "  \"program\": \"dominant-colors-bench\"," << std::endl
+         << "  \"opencv\": " << JSONString(CV_VERSION) << "," << std::endl
+         << "  \"cpus\": " << cv::getNumberOfCPUs() << "," << std::endl
+         << "  \"lab_cube\": " << (lab_cube ? "true" : "false") << "," << std::endl
+         << "  \"kmeans_bounds\": " << (kmeans_bounds ? "true" : "false") << "," << std::endl
+         << "  \"repeat\": " << repeat << "," << std::endl
+         << "  \"results\": [";
+
+    std::vector<struct_benchmark> benchmarks = Benchmarks(color_names);
+    bool first = true; // first result : no comma
+    for (unsigned int i = 0; i < images.size(); i++) {
+        struct_bench_image &bench = images[i];
+        if (bench.synthetic_megapixels > 0) // only one benchmark image in memory at a time
+            bench.image = SyntheticImage(bench.synthetic_megapixels);
+        else
+            bench.image = cv::imread(bench.name, cv::IMREAD_COLOR);
+        if (bench.image.empty()) {
+            std::cerr << "Warning: cannot read image " << bench.name << std::endl;
+            continue;
+        }
+        const double megapixels = double(bench.image.total()) / 1000000.0;
+
+        for (unsigned int b = 0; b < benchmarks.size(); b++) {
+            if ((!only.empty()) and (only.find("," + benchmarks[b].name + ",") == std::string::npos)) // not selected
+                continue;
+            if ((limits) and (benchmarks[b].max_megapixels > 0) and (megapixels > benchmarks[b].max_megapixels)) // too slow for this size
+                continue;
+
+            benchmarks[b].prepare(bench); // untimed inputs
+
+            for (unsigned int t = 0; t < threads.size(); t++) {
+                cv::setNumThreads(int(threads[t])); // also sets the number of row bands of parallel loops
+                std::cerr << benchmarks[b].name << " " << bench.name << " " << int(threads[t]) << " thread(s)" << std::endl; // progress
+
+                bool peak_reset = ResetPeakMemory(); // peak of this measure only, if possible
+                double peak_before = PeakMemoryMB(); // memory already used by inputs
+                std::vector<double> times(repeat); // wall time of each run in ms
+                for (int r = 0; r < repeat; r++) {
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    benchmarks[b].run(bench);
+                    times[r] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+                double peak = PeakMemoryMB();
+
+                std::sort(times.begin(), times.end());
+                const double median = times[repeat / 2];
+
+                json << (first ? "" : ",") << std::endl
+                     << "    {\"benchmark\": " << JSONString(benchmarks[b].name)
+                     << ", \"image\": " << JSONString(bench.name)
+                     << ", \"width\": " << bench.image.cols << ", \"height\": " << bench.image.rows
+                     << ", \"megapixels\": " << megapixels
+                     << ", \"threads\": " << int(threads[t])
+                     << ", \"wall_ms_median\": " << median << ", \"wall_ms_min\": " << times[0]
+                     << ", \"pixels_per_second\": " << (median > 0 ? double(bench.image.total()) * 1000.0 / median : 0)
+                     << ", \"peak_memory_mb\": " << peak
+                     << ", \"peak_memory_added_mb\": " << (peak_reset ? peak - peak_before : 0)
+                     << ", \"peak_memory_reset\": " << (peak_reset ? "true" : "false") << "}";
+                first = false;
+            }
+        }
+
+        bench.image.release(); // inputs of this image are not needed anymore : next image starts with the same memory
+        bench.lab.release();
+        bench.filtered.release();
+    }
+    json << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+    if (output.empty())
+        std::cout << json.str();
+    else {
+        std::ofstream save(output);
+        save << json.str();
+        save.close();
+        if (!save.good()) {
+            std::cerr << "Error: cannot write " << output << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+#   Dominant colors command-line tool - no Qt
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#-------------------------------------------------
+
+CONFIG -= qt
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = dominant-colors-cli
+TEMPLATE = app
+
+INCLUDEPATH += ../.. \
+               /usr/local/include/opencv4/opencv2
+
+LIBS += -L$$OUT_PWD/../lib -ldominant-colors \
+        -L/usr/local/lib
+PRE_TARGETDEPS += $$OUT_PWD/../lib/libdominant-colors.a
+
+SOURCES += dominant-colors-cli.cpp
+
+# we add the package opencv to pkg-config
+CONFIG += link_pkgconfig
+PKGCONFIG += opencv4
+
+CONFIG += c++11
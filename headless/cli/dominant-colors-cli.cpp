@@ -0,0 +1,518 @@
+/*#-------------------------------------------------
+#
+#     Dominant colors command-line tool - no Qt
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - same parameters as GUI
+#   - batch of images
+#   - palette saved to CSV file, quantized image to PNG
+#   - tiled mode for huge images, streamed from and
+#     to binary PPM files
+#   - sequence mode for videos and numbered images,
+#     palettes of all frames saved to a timeline CSV
+#
+#-------------------------------------------------*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cctype>
+#include <cstdio>
+
+#include "opencv2/opencv.hpp"
+
+#include "dominant-colors-pipeline.h"
+#include "color-names.h"
+#include "color-spaces.h"
+#include "profiler.h"
+
+void ShowUsage(const std::string &program) // command-line help
+{
+    std::cerr << "Usage: " << program << " [options] image [image...]" << std::endl
+              << "Options:" << std::endl
+              << "  -a, --algorithm NAME        sectored-means | eigen | k-means | mean-shift (default sectored-means)" << std::endl
+              << "  -n, --colors N              number of dominant colors (default 12, max " << nb_dominant_colors_max << ")" << std::endl
+              << "  --no-filter-grays           keep blacks, whites and grays" << std::endl
+              << "  --blacks D                  CIEDE2000 limit for blacks (default 18)" << std::endl
+              << "  --grays D                   CIEDE2000 limit for grays (default 9)" << std::endl
+              << "  --whites D                  CIEDE2000 limit for whites (default 18)" << std::endl
+              << "  --no-regroup                do not regroup near colors" << std::endl
+              << "  --regroup-distance D        CIEDE2000 distance to regroup colors (default 15)" << std::endl
+              << "  --no-filter-percent         keep colors under x% of image" << std::endl
+              << "  --filter-percentage X       x% for percentage filter (default 1)" << std::endl
+              << "  --kmeans-all-pixels         K-means on every pixel instead of weighted unique colors" << std::endl
+              << "  --kmeans-mini-batch         K-means on batches of random pixels, for very big images" << std::endl
+              << "  --kmeans-batch-size N       pixels in each mini-batch (default 4096)" << std::endl
+              << "  --kmeans-tolerance X        mini-batch ends when centers move less than X, CIELab in [0..1] (default 0.001)" << std::endl
+              << "  --mean-shift-spatial N      mean-shift spatial radius (default 4)" << std::endl
+              << "  --mean-shift-color N        mean-shift color radius (default 12)" << std::endl
+              << "  --sectored-means-levels N   sectored-means with N Lightness and Chroma levels" << std::endl
+              << "  --reduce-size               reduce image to 512 pixels before computing" << std::endl
+              << "  --gaussian-blur             blur image before computing" << std::endl
+              << "  --no-lab-cube               do not use the RGB to CIELab lookup cube (saves 192 MB, slower)" << std::endl
+              << "  --names FILE                color names CSV file instead of compiled-in names" << std::endl
+              << "  -o, --output-dir DIR        where to write results (default same as image)" << std::endl
+              << "  --quantized                 also save quantized image" << std::endl
+              << "  --tiled                     process image band by band in fixed memory - binary PPM files are streamed" << std::endl
+              << "  --tiled-memory MB           memory for bands in tiled mode (default " << tiled_memory_default << ")" << std::endl
+              << "  --sequence                  inputs are videos or numbered images patterns like frame-%04d.png" << std::endl
+              << "  --every N                   sequence mode : compute one frame every N frames (default 1)" << std::endl
+              << "  --trace FILE                save stages timings and counters as Chrome trace-event JSON" << std::endl;
+}
+
+std::string BaseName(const std::string &filename) // filename without path and extension
+{
+    size_t slash = filename.find_last_of("/\\"); // path separator
+    std::string base = (slash == std::string::npos) ? filename : filename.substr(slash + 1); // remove path
+    size_t dot = base.find_last_of('.'); // extension
+    if (dot != std::string::npos)
+        base = base.substr(0, dot); // remove extension
+    return base;
+}
+
+std::string DirName(const std::string &filename) // path of filename, with trailing separator
+{
+    size_t slash = filename.find_last_of("/\\"); // path separator
+    if (slash == std::string::npos)
+        return ""; // current directory
+    return filename.substr(0, slash + 1);
+}
+
+std::string SequenceBaseName(const std::string &filename) // video or numbered images pattern filename without path, extension and printf-like number
+{
+    std::string base = BaseName(filename);
+    size_t percent = base.find('%'); // "frame-%04d" -> "frame-"
+    if (percent != std::string::npos) {
+        size_t d = base.find('d', percent);
+        if (d != std::string::npos)
+            base.erase(percent, d - percent + 1);
+    }
+    while ((!base.empty()) and ((base.back() == '-') or (base.back() == '_') or (base.back() == '.'))) // no separator left at the end
+        base.pop_back();
+    if (base.empty())
+        base = "sequence";
+    return base;
+}
+
+///////////////////////////////////////////////////////////
+//// Binary PPM files read and written band by band
+///////////////////////////////////////////////////////////
+
+struct struct_ppm_file { // binary PPM file (P6, 8-bit RGB)
+    std::fstream file; // opened file
+    std::streamoff data; // position of first pixel
+    int rows, cols; // image size
+};
+
+bool IsPPMFile(const std::string &filename) // PPM or PNM extension ?
+{
+    size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string extension = filename.substr(dot + 1);
+    for (size_t i = 0; i < extension.size(); i++)
+        extension[i] = std::tolower(extension[i]);
+    return (extension == "ppm") or (extension == "pnm");
+}
+
+bool ReadPPMNumber(std::istream &file, int &value) // next number of PPM header, comments skipped - the whitespace after it is read too
+{
+    int c = file.get();
+    while ((file) and ((c == '#') or (std::isspace(c)))) {
+        if (c == '#') // comment until end of line
+            while ((file) and (c != '\n'))
+                c = file.get();
+        c = file.get();
+    }
+    if ((!file) or (!std::isdigit(c)))
+        return false;
+    value = 0;
+    while ((file) and (std::isdigit(c))) {
+        value = value * 10 + (c - '0');
+        c = file.get();
+    }
+    return true;
+}
+
+bool OpenPPM(const std::string &filename, struct_ppm_file &ppm) // open binary PPM file and read its header
+{
+    ppm.file.open(filename, std::ios::in | std::ios::binary);
+    int maxval;
+    if ((!ppm.file) or (ppm.file.get() != 'P') or (ppm.file.get() != '6') // binary RGB only
+            or (!ReadPPMNumber(ppm.file, ppm.cols)) or (!ReadPPMNumber(ppm.file, ppm.rows)) or (!ReadPPMNumber(ppm.file, maxval)) or (maxval != 255))
+        return false;
+    ppm.data = ppm.file.tellg();
+    return true;
+}
+
+bool CreatePPM(const std::string &filename, const int &rows, const int &cols, struct_ppm_file &ppm) // create binary PPM file and write its header
+{
+    ppm.file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    ppm.file << "P6\n" << cols << " " << rows << "\n255\n";
+    ppm.rows = rows;
+    ppm.cols = cols;
+    ppm.data = ppm.file.tellp();
+    return bool(ppm.file);
+}
+
+bool ReadPPMBand(struct_ppm_file &ppm, const int &y, const int &nb_rows, cv::Mat &band) // read rows [y..y + nb_rows[ as BGR
+{
+    band.create(nb_rows, ppm.cols, CV_8UC3);
+    ppm.file.seekg(ppm.data + std::streamoff(y) * ppm.cols * 3);
+    ppm.file.read(reinterpret_cast<char*>(band.data), std::streamsize(nb_rows) * ppm.cols * 3); // band is continuous
+    if (!ppm.file)
+        return false;
+    cv::cvtColor(band, band, cv::COLOR_RGB2BGR); // PPM is RGB
+    return true;
+}
+
+bool WritePPMBand(struct_ppm_file &ppm, const cv::Mat &band) // write BGR band after the previous ones
+{
+    cv::Mat rgb;
+    cv::cvtColor(band, rgb, cv::COLOR_BGR2RGB); // PPM is RGB
+    for (int y = 0; y < rgb.rows; y++)
+        ppm.file.write(reinterpret_cast<const char*>(rgb.ptr(y)), std::streamsize(rgb.cols) * 3);
+    return bool(ppm.file);
+}
+
+bool SavePaletteCSV(const std::string &filename, const struct_dominant_result &result) // save palette to CSV file "name;R;G;B;hexa;percentage"
+{
+    std::ofstream save; // file to save
+    save.open(filename); // open file
+    if (!save)
+        return false;
+
+    save << "Name;R;G;B;hexa;percentage" << std::endl; // header
+    for (int n = 0; n < result.nb_colors; n++) // for each dominant color
+        if (result.palette[n].R != -1) // not a dummy value
+            save << result.palette[n].name << ";"
+                 << result.palette[n].R << ";"
+                 << result.palette[n].G << ";"
+                 << result.palette[n].B << ";"
+                 << result.palette[n].hexa << ";"
+                 << result.palette[n].percentage << std::endl;
+
+    save.close(); // close text file
+    return save.good();
+}
+
+bool SaveTimelineCSV(std::ofstream &save, const struct_dominant_frame &frame) // append palette of a frame to timeline CSV file "Frame;Time;Name;R;G;B;hexa;percentage"
+{
+    for (int n = 0; n < frame.result.nb_colors; n++) // for each dominant color
+        if (frame.result.palette[n].R != -1) // not a dummy value
+            save << frame.index << ";"
+                 << frame.time << ";"
+                 << frame.result.palette[n].name << ";"
+                 << frame.result.palette[n].R << ";"
+                 << frame.result.palette[n].G << ";"
+                 << frame.result.palette[n].B << ";"
+                 << frame.result.palette[n].hexa << ";"
+                 << frame.result.palette[n].percentage << std::endl;
+    return save.good();
+}
+
+int main(int argc, char *argv[])
+{
+    struct_dominant_params params; // default values
+    std::vector<std::string> images; // images to process
+    std::string names_file; // color names database override - empty = compiled-in names
+    std::string output_dir; // empty = same directory as image
+    bool save_quantized = false; // save quantized image
+    bool reduce_size = false; // preprocessing options
+    bool gaussian_blur = false;
+    std::string trace_file; // empty = no timings
+    bool tiled = false; // process images band by band
+    int tiled_memory = tiled_memory_default; // memory for bands in MB
+    bool sequence = false; // inputs are videos or numbered images
+    int frame_step = 1; // one frame computed every frame_step frames
+
+    for (int i = 1; i < argc; i++) { // parse command-line
+        std::string arg = argv[i]; // current argument
+        bool has_value = (i + 1 < argc); // is there another argument after this one ?
+
+        if ((arg == "-h") or (arg == "--help")) {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+        else if (((arg == "-a") or (arg == "--algorithm")) and (has_value)) {
+            std::string value = argv[++i];
+            if (value == "sectored-means")
+                params.algorithm = algorithm_sectored_means;
+            else if (value == "eigen")
+                params.algorithm = algorithm_eigen_vectors;
+            else if (value == "k-means")
+                params.algorithm = algorithm_k_means;
+            else if (value == "mean-shift")
+                params.algorithm = algorithm_mean_shift;
+            else {
+                std::cerr << "Unknown algorithm: " << value << std::endl;
+                return 1;
+            }
+        }
+        else if (((arg == "-n") or (arg == "--colors")) and (has_value))
+            params.nb_colors = std::atoi(argv[++i]);
+        else if (arg == "--no-filter-grays")
+            params.filter_grays = false;
+        else if ((arg == "--blacks") and (has_value))
+            params.blacks_limit = std::atof(argv[++i]);
+        else if ((arg == "--grays") and (has_value))
+            params.grays_limit = std::atof(argv[++i]);
+        else if ((arg == "--whites") and (has_value))
+            params.whites_limit = std::atof(argv[++i]);
+        else if (arg == "--no-regroup")
+            params.regroup = false;
+        else if ((arg == "--regroup-distance") and (has_value))
+            params.regroup_distance = std::atof(argv[++i]);
+        else if (arg == "--no-filter-percent")
+            params.filter_percent = false;
+        else if ((arg == "--filter-percentage") and (has_value))
+            params.filter_percentage = std::atoi(argv[++i]);
+        else if (arg == "--kmeans-all-pixels")
+            params.kmeans_mode = kmeans_all_pixels;
+        else if (arg == "--kmeans-mini-batch")
+            params.kmeans_mode = kmeans_mini_batch;
+        else if ((arg == "--kmeans-batch-size") and (has_value)) {
+            params.kmeans_mode = kmeans_mini_batch;
+            params.kmeans_batch_size = std::atoi(argv[++i]);
+        }
+        else if ((arg == "--kmeans-tolerance") and (has_value)) {
+            params.kmeans_mode = kmeans_mini_batch;
+            params.kmeans_tolerance = std::atof(argv[++i]);
+        }
+        else if ((arg == "--mean-shift-spatial") and (has_value))
+            params.mean_shift_spatial = std::atoi(argv[++i]);
+        else if ((arg == "--mean-shift-color") and (has_value))
+            params.mean_shift_color = std::atoi(argv[++i]);
+        else if ((arg == "--sectored-means-levels") and (has_value)) {
+            params.sectored_means_levels = true;
+            params.sectored_means_nb_levels = std::atoi(argv[++i]);
+        }
+        else if (arg == "--reduce-size")
+            reduce_size = true;
+        else if (arg == "--gaussian-blur")
+            gaussian_blur = true;
+        else if (arg == "--no-lab-cube")
+            EnableRGBtoLabCube(false);
+        else if ((arg == "--names") and (has_value))
+            names_file = argv[++i];
+        else if (((arg == "-o") or (arg == "--output-dir")) and (has_value)) {
+            output_dir = argv[++i];
+            if ((!output_dir.empty()) and (output_dir.back() != '/') and (output_dir.back() != '\\'))
+                output_dir += "/"; // add trailing separator
+        }
+        else if (arg == "--quantized")
+            save_quantized = true;
+        else if ((arg == "--trace") and (has_value))
+            trace_file = argv[++i];
+        else if (arg == "--tiled")
+            tiled = true;
+        else if ((arg == "--tiled-memory") and (has_value)) {
+            tiled = true;
+            tiled_memory = std::atoi(argv[++i]);
+        }
+        else if (arg == "--sequence")
+            sequence = true;
+        else if ((arg == "--every") and (has_value)) {
+            sequence = true;
+            frame_step = std::atoi(argv[++i]);
+        }
+        else if ((!arg.empty()) and (arg[0] == '-')) {
+            std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+            ShowUsage(argv[0]);
+            return 1;
+        }
+        else
+            images.push_back(arg); // not an option : image filename
+    }
+
+    if (images.empty()) { // nothing to do
+        ShowUsage(argv[0]);
+        return 1;
+    }
+
+    if ((params.nb_colors < 1) or (params.nb_colors > nb_dominant_colors_max)) { // check number of colors
+        std::cerr << "Number of colors must be in [1.." << nb_dominant_colors_max << "]" << std::endl;
+        return 1;
+    }
+
+    if ((params.kmeans_mode == kmeans_mini_batch) and ((params.kmeans_batch_size < 1) or (params.kmeans_tolerance < 0))) { // check mini-batch options
+        std::cerr << "Mini-batch size must be at least 1 and tolerance positive" << std::endl;
+        return 1;
+    }
+
+    if (sequence) { // check sequence mode options
+        if (tiled) {
+            std::cerr << "Tiled mode is not available in sequence mode" << std::endl;
+            return 1;
+        }
+        if (frame_step < 1) {
+            std::cerr << "Frame step must be at least 1" << std::endl;
+            return 1;
+        }
+    }
+
+    if (tiled) { // check tiled mode options
+        if (params.algorithm == algorithm_mean_shift) {
+            std::cerr << "Mean-shift is not available in tiled mode: it needs all the neighbors of each pixel" << std::endl;
+            return 1;
+        }
+        if (tiled_memory < 1) {
+            std::cerr << "Memory for bands must be at least 1 MB" << std::endl;
+            return 1;
+        }
+        if ((reduce_size) or (gaussian_blur)) // these need the whole image
+            std::cerr << "Warning: --reduce-size and --gaussian-blur are not used in tiled mode" << std::endl;
+    }
+
+    struct_color_names color_names; // color names database
+    if ((names_file.empty()) or (!LoadColorNames(names_file, color_names))) { // no override file, or not found
+        if (!names_file.empty()) // not fatal : compiled-in names will be used
+            std::cerr << "Warning: color names file " << names_file << " not found, using compiled-in names" << std::endl;
+        LoadBuiltinColorNames(color_names); // compiled-in color names
+    }
+
+    struct_profile profile; // stages timings and counters of all images
+    ProfileActive profile_active(profile); // recorded even without --trace : negligible cost
+
+    int errors = 0; // number of images that failed
+    for (unsigned int i = 0; i < images.size(); i++) { // process each image
+        std::string base = (output_dir.empty() ? DirName(images[i]) : output_dir) + BaseName(images[i]); // output filenames base
+
+        if (sequence) { // frames decoded on another thread, K-means warm-started from previous frame
+            base = (output_dir.empty() ? DirName(images[i]) : output_dir) + SequenceBaseName(images[i]); // no frame number in output filenames
+            std::ofstream timeline(base + "-timeline.csv"); // palettes of all frames
+            if (!timeline) {
+                std::cerr << "Error: cannot write " << base << "-timeline.csv" << std::endl;
+                errors++;
+                continue;
+            }
+            timeline << "Frame;Time;Name;R;G;B;hexa;percentage" << std::endl; // header
+
+            bool written = true; // all frames written
+            int nb_frames = ComputeDominantColorsSequence(images[i], frame_step, gaussian_blur, reduce_size, params, color_names,
+                                                          [&](const struct_dominant_frame &frame) {
+                                                              if (!SaveTimelineCSV(timeline, frame)) {
+                                                                  std::cerr << "Error: cannot write " << base << "-timeline.csv" << std::endl;
+                                                                  written = false;
+                                                                  return false; // stop
+                                                              }
+                                                              if (save_quantized) {
+                                                                  char number[16];
+                                                                  std::snprintf(number, sizeof(number), "%06d", frame.index);
+                                                                  std::string filename = base + "-quantized-" + number + ".png";
+                                                                  if (!cv::imwrite(filename, frame.result.quantized)) {
+                                                                      std::cerr << "Error: cannot write " << filename << std::endl;
+                                                                      written = false;
+                                                                      return false; // stop
+                                                                  }
+                                                              }
+                                                              return true;
+                                                          });
+            if (nb_frames < 0) {
+                std::cerr << "Error: cannot read video or images sequence " << images[i] << std::endl;
+                errors++;
+                continue;
+            }
+            if (!written) {
+                errors++;
+                continue;
+            }
+            std::cout << images[i] << ": " << nb_frames << " frames" << std::endl; // progress
+            continue;
+        }
+
+        if (tiled) { // band by band : palette and quantized image written without the whole image in memory
+            struct_dominant_result result; // palette only, quantized bands are written by writer
+            bool done;
+            if (IsPPMFile(images[i])) { // streamed from and to PPM files
+                struct_ppm_file source, quantized;
+                if (!OpenPPM(images[i], source)) {
+                    std::cerr << "Error: cannot read image " << images[i] << " (binary 8-bit PPM only)" << std::endl;
+                    errors++;
+                    continue;
+                }
+                if ((save_quantized) and (!CreatePPM(base + "-quantized.ppm", source.rows, source.cols, quantized))) {
+                    std::cerr << "Error: cannot write " << base << "-quantized.ppm" << std::endl;
+                    errors++;
+                    continue;
+                }
+                done = ComputeDominantColorsTiled(source.rows, source.cols,
+                                                  [&source](const int &y, const int &nb_rows, cv::Mat &band) { return ReadPPMBand(source, y, nb_rows, band); },
+                                                  TiledBandRows(source.cols, tiled_memory), params, color_names, result,
+                                                  [&](const int &y, const cv::Mat &band) { return (!save_quantized) or (WritePPMBand(quantized, band)); });
+            }
+            else { // OpenCV can't read a part of an image : loaded at once, but not copied
+                ProfileStage stage("load");
+                cv::Mat image = cv::imread(images[i], cv::IMREAD_COLOR); // load image as BGR
+                stage.Stop();
+                if (image.empty()) {
+                    std::cerr << "Error: cannot read image " << images[i] << std::endl;
+                    errors++;
+                    continue;
+                }
+                done = ComputeDominantColorsTiled(image.rows, image.cols, MatBandReader(image), TiledBandRows(image.cols, tiled_memory), params, color_names, result,
+                                                  [&](const int &y, const cv::Mat &band) { // each band is read before being written : quantized image replaces source image
+                                                      if (save_quantized)
+                                                          band.copyTo(image.rowRange(y, y + band.rows));
+                                                      return true;
+                                                  });
+                if ((done) and (save_quantized) and (!cv::imwrite(base + "-quantized.png", image))) {
+                    std::cerr << "Error: cannot write " << base << "-quantized.png" << std::endl;
+                    errors++;
+                    continue;
+                }
+            }
+
+            if (!done) {
+                std::cerr << "Error: cannot process image " << images[i] << " in tiled mode" << std::endl;
+                errors++;
+                continue;
+            }
+            if (!SavePaletteCSV(base + "-palette.csv", result)) {
+                std::cerr << "Error: cannot write " << base << "-palette.csv" << std::endl;
+                errors++;
+                continue;
+            }
+            std::cout << images[i] << ": " << result.nb_colors << " colors" << std::endl; // progress
+            continue;
+        }
+
+        ProfileStage stage("load");
+        cv::Mat image = cv::imread(images[i], cv::IMREAD_COLOR); // load image as BGR
+        stage.Stop();
+        if (image.empty()) {
+            std::cerr << "Error: cannot read image " << images[i] << std::endl;
+            errors++;
+            continue;
+        }
+
+        image = PreprocessImage(image, gaussian_blur, reduce_size); // blur and resize
+
+        struct_dominant_result result; // palette and quantized image
+        ComputeDominantColors(image, params, color_names, result); // compute dominant colors
+
+        if (!SavePaletteCSV(base + "-palette.csv", result)) {
+            std::cerr << "Error: cannot write " << base << "-palette.csv" << std::endl;
+            errors++;
+            continue;
+        }
+
+        if ((save_quantized) and (!cv::imwrite(base + "-quantized.png", result.quantized))) {
+            std::cerr << "Error: cannot write " << base << "-quantized.png" << std::endl;
+            errors++;
+            continue;
+        }
+
+        std::cout << images[i] << ": " << result.nb_colors << " colors" << std::endl; // progress
+    }
+
+    if ((!trace_file.empty()) and (!SaveProfileTrace(trace_file, profile))) {
+        std::cerr << "Error: cannot write " << trace_file << std::endl;
+        errors++;
+    }
+
+    return (errors > 0) ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+#   Dominant colors from image with openCV
+#    headless library + command-line + benchmark
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS = lib \
+          cli \
+          bench
+
+cli.depends = lib
+bench.depends = lib
@@ -0,0 +1,45 @@
+#-------------------------------------------------
+#
+#   Dominant colors static library - no Qt
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#-------------------------------------------------
+
+CONFIG -= qt
+
+TARGET = dominant-colors
+TEMPLATE = lib
+CONFIG += staticlib
+
+INCLUDEPATH += /usr/local/include/opencv4/opencv2
+
+LIBS += -L/usr/local/lib
+
+SOURCES += ../../mat-image-tools.cpp \
+           ../../dominant-colors.cpp \
+           ../../dominant-colors-pipeline.cpp \
+           ../../color-names.cpp \
+           ../../color-spaces.cpp \
+           ../../angles.cpp \
+           ../../profiler.cpp
+
+HEADERS += ../../mat-image-tools.h \
+           ../../dominant-colors.h \
+           ../../dominant-colors-pipeline.h \
+           ../../color-names.h \
+           ../../color-spaces.h \
+           ../../color-spaces-kernels.h \
+           ../../angles.h \
+           ../../profiler.h
+
+# we add the package opencv to pkg-config
+CONFIG += link_pkgconfig
+PKGCONFIG += opencv4
+
+CONFIG += c++11
+
+# color names table generated at build time from color-names.csv : compiled-in, no CSV parsing at launch
+include(../../color-names-table.pri)
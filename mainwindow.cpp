@@ -20,11 +20,15 @@
 #include <QPainter>
 #include <QScrollBar>
 #include <QWhatsThis>
+#include <QVBoxLayout>
+#include <QPushButton>
+#include <QtConcurrent/QtConcurrent>
 
 #include <fstream>
 
 #include "mat-image-tools.h"
 #include "dominant-colors.h"
+#include "dominant-colors-pipeline.h"
 #include "color-spaces.h"
 #include "angles.h"
 
@@ -55,6 +59,7 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    compute_watcher.waitForFinished(); // the compute worker writes to this window
     delete ui;
 }
 
@@ -84,6 +89,7 @@ void MainWindow::InitializeValues() // Global variables and GUI elements init
 
     // Wheel
     nb_palettes= -1; // no palette yet
+    scheme_borders = false; // no color schemes yet
     ShowWheel(); // draw empty wheel
     pickedColor = cv::Vec3b(-1, -1, -1); // dummy values
 
@@ -109,6 +115,31 @@ void MainWindow::InitializeValues() // Global variables and GUI elements init
     connect(this->ui->scrollArea_quantized->horizontalScrollBar(), SIGNAL(valueChanged(int)),
             this->ui->scrollArea_image->horizontalScrollBar(), SLOT(setValue(int)));
 
+    // compute worker
+    computing = false; // not computing yet
+    connect(&compute_watcher, SIGNAL(finished()), this, SLOT(ComputeFinished())); // show results when worker has finished
+    connect(&live_timer, SIGNAL(timeout()), this, SLOT(ShowLiveTimer())); // show elapsed time while computing
+
+    // timings panel : floating, hidden until timer is clicked
+    timings_dock = new QDockWidget("Timings", this); // panel
+    timings_dock->setObjectName("timings_dock");
+    QWidget *timings_widget = new QWidget(timings_dock); // panel content
+    QVBoxLayout *timings_layout = new QVBoxLayout(timings_widget);
+    timings_tree = new QTreeWidget(timings_widget); // stages, collapsible
+    timings_tree->setHeaderLabels(QStringList() << "Stage" << "ms" << "%");
+    timings_tree->setColumnWidth(0, 220);
+    timings_tree->setWhatsThis("Time spent in each stage of last Load, Quantize and Analyze, and algorithm counters");
+    timings_layout->addWidget(timings_tree);
+    QPushButton *button_save_trace = new QPushButton("Save trace...", timings_widget); // export
+    button_save_trace->setWhatsThis("Save timings as a Chrome trace-event JSON file : open it in chrome://tracing or ui.perfetto.dev");
+    timings_layout->addWidget(button_save_trace);
+    connect(button_save_trace, SIGNAL(clicked()), this, SLOT(SaveTrace()));
+    timings_dock->setWidget(timings_widget);
+    addDockWidget(Qt::RightDockWidgetArea, timings_dock);
+    timings_dock->setFloating(true); // don't change main window layout
+    timings_dock->resize(360, 420);
+    timings_dock->hide();
+
     // other GUI items
     ui->frame_analysis->setVisible(false); // frames
     ui->frame_analyze->setVisible(false);
@@ -130,39 +161,9 @@ void MainWindow::InitializeValues() // Global variables and GUI elements init
     ui->comboBox_sort->addItem("Rainbow6");
     ui->comboBox_sort->blockSignals(false); // return to normal behavior
 
-    // read color names from .csv file
-    std::string line; // line to read in text file
-    std::ifstream names; // file to read
-    names.open("color-names.csv"); // read color names file
-
-    if (names) { // if successfully read
-        nb_color_names = -1; // index of color names array
-        size_t pos; // index for find function
-        std::string s; // used for item extraction
-        getline(names, line); // read first line (header)
-        while (getline(names, line)) { // read each line of text file: R G B name
-            pos = 0; // find index at the beginning of the line
-            nb_color_names++; // current index in color names array
-            int pos2 = line.find(";", pos); // find first semicolon char
-            s = line.substr(pos, pos2 - pos); // extract R value
-            color_names[nb_color_names].R = std::stoi(s); // R in array
-            pos = pos2 + 1; // next char
-            pos2 = line.find(";", pos); // find second semicolon char
-            s = line.substr(pos, pos2 - pos); // extract G value
-            color_names[nb_color_names].G = std::stoi(s); // G in array
-            pos = pos2 + 1; // next char
-            pos2 = line.find(";", pos); // find third semicolon char
-            s = line.substr(pos, pos2 - pos); // extract B value
-            color_names[nb_color_names].B = std::stoi(s); // B in array
-            s = line.substr(pos2 + 1, line.length() - pos2); // color name is at the end of the line
-            color_names[nb_color_names].name = QString::fromStdString(s); // color name in array
-        }
-
-        names.close(); // close text file
-    }
-    else {
-        QMessageBox::critical(this, "Colors CSV file not found!", "You forgot to put 'color-names.csv' in the same folder as the executable! This tool will crash as soon as you quantize an image...");
-    }
+    // color names : compiled-in table, or 'color-names.csv' in the same folder as the executable to use your own names
+    if (!LoadColorNames("color-names.csv", color_names)) // no override file
+        LoadBuiltinColorNames(color_names); // compiled-in color names
 
     /*for (int n = 0; n <= 24; n++) {
         long double R, G, B;
@@ -194,31 +195,37 @@ void MainWindow::on_button_compute_clicked() // compute dominant colors and resu
 
 void MainWindow::on_pushButton_color_complementary_clicked() // hide/show color scheme : complementary
 {
+    ComputeWheelOverlay();
     OverlayWheel();
 }
 
 void MainWindow::on_pushButton_color_split_complementary_clicked() // hide/show color scheme : split-complementary
 {
+    ComputeWheelOverlay();
     OverlayWheel();
 }
 
 void MainWindow::on_pushButton_color_analogous_clicked() // hide/show color scheme : analogous
 {
+    ComputeWheelOverlay();
     OverlayWheel();
 }
 
 void MainWindow::on_pushButton_color_triadic_clicked() // hide/show color scheme : triadic
 {
+    ComputeWheelOverlay();
     OverlayWheel();
 }
 
 void MainWindow::on_pushButton_color_tetradic_clicked() // hide/show color scheme : tetradic
 {
+    ComputeWheelOverlay();
     OverlayWheel();
 }
 
 void MainWindow::on_pushButton_color_square_clicked() // hide/show color scheme : square
 {
+    ComputeWheelOverlay();
     OverlayWheel();
 }
 
@@ -370,28 +377,57 @@ void MainWindow::on_button_zoom_image_clicked() // zoom image
     ShowResults();
 }
 
-void MainWindow::OverlayWheel() // draw layers on wheel
+void MainWindow::ComputeWheelOverlay() // draw enabled color schemes in one layer, composited later on wheel
 {
-    wheel.copyTo(wheel_result); // get what's already drawn on wheel
-
-    // add found color schemes to wheel image
-    if (ui->pushButton_color_complementary->isChecked())
-        cv::addWeighted(wheel_mask_complementary, 1, wheel_result, 1, 0, wheel_result, -1);
+    wheel_overlay.create(wheel.rows, wheel.cols, CV_8UC3); // only reallocated when wheel size changes
+    wheel_overlay = cv::Vec3b(0, 0, 0); // no color scheme
+    wheel_overlay_area = cv::Rect(); // nothing to composite
 
-    if (ui->pushButton_color_split_complementary->isChecked())
-        cv::addWeighted(wheel_mask_split_complementary, 1, wheel_result, 1, 0, wheel_result, -1);
+    if (scheme_colors.empty()) // Analyze not done
+        return;
 
-    if (ui->pushButton_color_analogous->isChecked())
-        cv::addWeighted(wheel_mask_analogous, 0.99, wheel_result, 1, 0, wheel_result, -1);
+    std::vector<cv::Point> dots(scheme_colors.size()); // position of each dot for current wheel size
+    for (unsigned int n = 0; n < scheme_colors.size(); n++)
+        dots[n] = SchemeDotPosition(scheme_colors[n].H, scheme_colors[n].L, scheme_borders);
+
+    // lines can only be drawn around the dots : work in this area, with a margin for thick antialiased lines
+    wheel_overlay_area = cv::boundingRect(dots);
+    wheel_overlay_area = cv::Rect(wheel_overlay_area.x - 5, wheel_overlay_area.y - 5, wheel_overlay_area.width + 11, wheel_overlay_area.height + 11)
+                        & cv::Rect(0, 0, wheel.cols, wheel.rows);
+    for (unsigned int n = 0; n < dots.size(); n++) // dots relative to this area
+        dots[n] -= wheel_overlay_area.tl();
+
+    // each scheme is drawn alone then added to overlay, with the same weights as before : lines of different schemes add up
+    cv::Mat overlay = wheel_overlay(wheel_overlay_area); // overlay area
+    cv::Mat layer = cv::Mat::zeros(overlay.rows, overlay.cols, CV_8UC3); // one color scheme
+    const struct {bool enabled; const std::vector<uchar> &segments; cv::Vec3b color, inside; double weight;} schemes[] = { // color schemes to draw
+        {ui->pushButton_color_complementary->isChecked(), scheme_complementary, cv::Vec3b(0, 0, 255), cv::Vec3b(255, 255, 255), 1}, // red with white inside
+        {ui->pushButton_color_split_complementary->isChecked(), scheme_split_complementary, cv::Vec3b(255, 255, 0), cv::Vec3b(0, 0, 0), 1}, // cyan with black inside
+        {ui->pushButton_color_analogous->isChecked(), scheme_analogous, cv::Vec3b(0, 255, 0), cv::Vec3b(255, 255, 255), 0.99}, // green with white inside
+        {ui->pushButton_color_triadic->isChecked(), scheme_triadic, cv::Vec3b(255, 0, 0), cv::Vec3b(255, 255, 255), 0.99}, // blue with white inside
+        {ui->pushButton_color_tetradic->isChecked(), scheme_tetradic, cv::Vec3b(255, 0, 255), cv::Vec3b(255, 255, 255), 0.99}, // violet with white inside
+        {ui->pushButton_color_square->isChecked(), scheme_square, cv::Vec3b(0, 127, 255), cv::Vec3b(0, 0, 0), 0.99} // orange with black inside
+    };
+    for (unsigned int s = 0; s < sizeof(schemes) / sizeof(schemes[0]); s++)
+        if ((schemes[s].enabled) and (std::find(schemes[s].segments.begin(), schemes[s].segments.end(), 1) != schemes[s].segments.end())) { // scheme shown and found
+            layer = cv::Vec3b(0, 0, 0); // empty layer
+            DrawSchemeSegments(layer, schemes[s].segments, dots, schemes[s].color, schemes[s].inside); // draw lines
+            cv::addWeighted(layer, schemes[s].weight, overlay, 1, 0, overlay, -1); // add to overlay
+        }
+}
 
-    if (ui->pushButton_color_triadic->isChecked())
-        cv::addWeighted(wheel_mask_triadic, 0.99, wheel_result, 1, 0, wheel_result, -1);
+void MainWindow::OverlayWheel() // draw layers on wheel
+{
+    if (wheel_overlay.size() != wheel.size()) // wheel resized : color schemes dots have moved
+        ComputeWheelOverlay();
 
-    if (ui->pushButton_color_tetradic->isChecked())
-        cv::addWeighted(wheel_mask_tetradic, 0.99, wheel_result, 1, 0, wheel_result, -1);
+    wheel.copyTo(wheel_result); // get what's already drawn on wheel
 
-    if (ui->pushButton_color_square->isChecked())
-        cv::addWeighted(wheel_mask_square, 0.99, wheel_result, 1, 0, wheel_result, -1);
+    // add found color schemes to wheel image : one saturated sum, only where lines are drawn
+    if (wheel_overlay_area.area() > 0) {
+        cv::Mat result = wheel_result(wheel_overlay_area); // area of wheel result where lines are drawn
+        cv::add(result, wheel_overlay(wheel_overlay_area), result);
+    }
 
     ui->label_wheel->setPixmap(Mat2QPixmap(wheel_result)); // update wheel view
 }
@@ -402,21 +438,16 @@ void MainWindow::on_button_analyze_clicked() // analyze image to find color sche
         QMessageBox::critical(this, "Nothing to do!", "You have to load then compute before analyzing an image");
         return;
     }
+    if (computing) // palette is about to be replaced
+        return;
 
     QApplication::setOverrideCursor(Qt::WaitCursor); // wait cursor
     timer.start(); // reinit timer
     ShowTimer(true); // show it
     qApp->processEvents();
-
-    ShowWheel(); // get a fresh empty wheel
-
-    // init color schemes layers to empty
-    wheel_mask_complementary = cv::Mat::zeros(cv::Size(wheel.cols, wheel.rows), CV_8UC3);
-    wheel_mask_split_complementary = cv::Mat::zeros(cv::Size(wheel.cols, wheel.rows), CV_8UC3);
-    wheel_mask_analogous = cv::Mat::zeros(cv::Size(wheel.cols, wheel.rows), CV_8UC3);
-    wheel_mask_triadic = cv::Mat::zeros(cv::Size(wheel.cols, wheel.rows), CV_8UC3);
-    wheel_mask_tetradic = cv::Mat::zeros(cv::Size(wheel.cols, wheel.rows), CV_8UC3);
-    wheel_mask_square = cv::Mat::zeros(cv::Size(wheel.cols, wheel.rows), CV_8UC3);
+    profile_analyze = struct_profile(); // new timings
+    ProfileActive profile_active(profile_analyze); // record analyze stages
+    ProfileStage stage("color schemes");
 
     // only keep colors in palette for schemes discovery : no grays, no whites, no blacks + keep significant percentage only
     struct_palette palet[nb_palettes_max]; // temp copy of palette
@@ -432,283 +463,141 @@ void MainWindow::on_button_analyze_clicked() // analyze image to find color sche
             nb_palet++; // temp palette index
         }
 
-    // draw hues on wheel external circle
-    for (int n = 0; n < nb_palet; n++) { // parse temp palette
-        long double S = 1; // max chroma and normal lightness
-        long double L = 0.5;
-        long double R, G, B;
-        HSLtoRGB(palet[n].H, S, L, R, G, B); // convert maxed current hue to RGB
-        DrawOnWheelBorder(int(round(R * 255.0)), int(round(G * 255.0)), int(round(B * 255.0)), 10, true); // draw a black dot on external circle of wheel
-    }
-
-    // compute angles between dots
-    long double H_max = 0; // to keep maximum angle between all dots
-    for (int x = 0; x < nb_palet; x++) { // populate double-entry angles array
-        for (int y = 0; y < nb_palet; y++)
-            if (x !=y) { // no angle between a dot and itself !
-                angles[x][y] = Angle::DifferenceDeg(Angle::NormalizedToDeg(palet[x].H), Angle::NormalizedToDeg(palet[y].H)); // angle between 2 dots
+    // colors kept for color schemes : their hues are drawn on wheel external circle, and their positions used to draw lines
+    scheme_colors.assign(palet, palet + nb_palet);
+    scheme_borders = ui->checkBox_color_borders->isChecked(); // lines between dots or external circle ?
 
-                if (angles[x][y] > H_max) // get maximum angle difference
-                        H_max = angles[x][y];
+    // hues of dots sorted on the circle : each color scheme is searched in hue windows, not in all the dots
+    std::vector<long double> hue(nb_palet); // hue of each dot in degrees
+    std::vector<std::pair<long double, int>> sorted_hues(nb_palet); // hue and index of dot, sorted by hue
+    for (int n = 0; n < nb_palet; n++) {
+        hue[n] = Angle::NormalizedToDeg(palet[n].H);
+        sorted_hues[n] = std::make_pair(hue[n], n);
+    }
+    std::sort(sorted_hues.begin(), sorted_hues.end());
+
+    auto angle = [&hue](const int &a, const int &b) { return Angle::DifferenceDeg(hue[a], hue[b]); }; // angle between 2 dots in [0..180]
+    auto window = [&sorted_hues, &hue](const int &a, const long double &low, const long double &high) { // dots at an angle in [low..high] from dot a - 1° more on each side, caller checks exact angle
+        std::vector<int> found;
+        const long double arcs[2][2] = {{hue[a] + low - 1, hue[a] + high + 1}, {hue[a] - high - 1, hue[a] - low + 1}}; // both sides of dot a
+        for (int side = 0; side < 2; side++)
+            for (int turn = -1; turn <= 1; turn++) { // arcs may cross 0° or 360°
+                std::vector<std::pair<long double, int>>::const_iterator first = std::lower_bound(sorted_hues.begin(), sorted_hues.end(), std::make_pair(arcs[side][0] + 360.0L * turn, -1));
+                for (std::vector<std::pair<long double, int>>::const_iterator it = first; (it != sorted_hues.end()) and (it->first <= arcs[side][1] + 360.0L * turn); it++)
+                    if (it->second != a)
+                        found.push_back(it->second);
             }
-            else
-                angles[x][y] = -1000.0; // dummy value
+        std::sort(found.begin(), found.end()); // both sides can overlap near 180°
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+        return found;
+    };
+
+    long double H_max = 0; // to keep maximum angle between all dots : the farthest dot from each dot is near the opposite hue
+    for (int x = 0; x < nb_palet; x++) {
+        std::vector<int> opposite = window(x, 180 - 1, 180); // nearest dots to the opposite hue
+        for (int d = 1; (opposite.empty()) and (d < 180); d *= 2) // widen window until a dot is found
+            opposite = window(x, std::max(0, 180 - 2 * d), 180);
+        for (unsigned int o = 0; o < opposite.size(); o++)
+            H_max = std::max(H_max, angle(x, opposite[o]));
     }
 
-    bool complementaryFound = false, analogousFound = false, triadicFound = false,
-            splitComplementaryFound = false, tetradicFound = false, squareFound = false; // indicators of found color schemes
+    // segments of each color scheme : segment (a, b) is drawn once, even if found in several schemes of the same kind
+    std::vector<uchar> &complementary = scheme_complementary, &analogous = scheme_analogous, &triadic = scheme_triadic,
+                       &splitComplementary = scheme_split_complementary, &tetradic = scheme_tetradic, &square = scheme_square;
+    for (std::vector<uchar> *segments : {&complementary, &analogous, &triadic, &splitComplementary, &tetradic, &square})
+        segments->assign(nb_palet * nb_palet, 0); // no segment yet
+    auto segment = [nb_palet](std::vector<uchar> &segments, const int &a, const int &b) { segments[std::min(a, b) * nb_palet + std::max(a, b)] = 1; };
+
+    for (int x = 0; x < nb_palet; x++) { // parse dots
+        std::vector<int> Y = window(x, 155, 180); // complementary : a 180° angle
+        for (unsigned int i = 0; i < Y.size(); i++)
+            if (abs(180.0 - angle(x, Y[i])) <= 25)
+                segment(complementary, x, Y[i]);
+
+        Y = window(x, 15, 45); // analogous : 3 dots, separated by ~30°
+        for (unsigned int i = 0; i < Y.size(); i++) {
+            const int y = Y[i];
+            if (abs(30.0 - angle(x, y)) >= 15)
+                continue;
+            std::vector<int> Z = window(y, 15, 45); // 3rd dot with the angle : ~30°
+            for (unsigned int j = 0; j < Z.size(); j++)
+                if ((Z[j] != x) and (abs(30.0 - angle(y, Z[j])) < 15) and (angle(x, Z[j]) > 45)) {
+                    segment(analogous, x, y);
+                    segment(analogous, y, Z[j]);
+                }
+        }
 
-    long double colorRadius1, colorRadius2, colorRadius3, colorRadius4; // radius of color dots on the wheel
-    for (int x = 0; x < nb_palet; x++) { // parse the angles array
-        for (int y = 0; y < nb_palet; y++) {
-            if (abs(180.0 - angles[x][y]) <= 25) { // complementary : a 180° angle
-                // first dot coordinates
-                if (ui->checkBox_color_borders->isChecked()) // draw on dot or external circle ?
-                    colorRadius1 = wheel_radius; // external circle
-                else
-                    colorRadius1 = (long double)(wheel_radius_center) * palet[x].L; // color distance from center
-                long double angle1 = -Angle::NormalizedToRad(palet[x].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset1 = wheel_center.x + cosf(angle1) * colorRadius1; // position from center of circle
-                long double yOffset1 = wheel_center.y + sinf(angle1) * colorRadius1;
-                // second dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius2 = wheel_radius;
-                else
-                    colorRadius2 = (long double)(wheel_radius_center) * palet[y].L; // color distance from center
-                long double angle2 = -Angle::NormalizedToRad(palet[y].H + 0.25); // angle convert normalized value to radians
-                long double xOffset2 = wheel_center.x + cosf(angle2) * colorRadius2; // position from center of circle
-                long double yOffset2 = wheel_center.y + sinf(angle2) * colorRadius2;
-
-                // draw a line between the two dots : red with white inside
-                cv::line(wheel_mask_complementary, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(0, 0, 255), 5, cv::LINE_AA);
-                cv::line(wheel_mask_complementary, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                complementaryFound = true; // color scheme found !
-            }
-            if ((x != y) and (abs(30.0 - angles[x][y]) < 15)) { // analogous : 3 dots, separated by ~30°
-                // no need to add much comments now, it is all the same than before
-                // first dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius1 = wheel_radius;
-                else
-                    colorRadius1 = (long double)(wheel_radius_center) * palet[x].L; // color distance from center
-                long double angle1 = -Angle::NormalizedToRad(palet[x].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset1 = wheel_center.x + cosf(angle1) * colorRadius1; // position from center of circle
-                long double yOffset1 = wheel_center.y + sinf(angle1) * colorRadius1;
-                // second dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius2 = wheel_radius;
-                else
-                    colorRadius2 = (long double)(wheel_radius_center) * palet[y].L; // color distance from center
-                long double angle2 = -Angle::NormalizedToRad(palet[y].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset2 = wheel_center.x + cosf(angle2) * colorRadius2; // position from center of circle
-                long double yOffset2 = wheel_center.y + sinf(angle2) * colorRadius2;
-
-                for (int z = 0; z < nb_palet; z++) // look for 3rd dot
-                    if ((z != x) and (z != y) and (abs(30.0 - angles[y][z]) < 15) and (angles[x][z] > 45)) { // with the angle : ~30°
-                        // 3rd dot coordinates
-                        if (ui->checkBox_color_borders->isChecked())
-                            colorRadius3 = wheel_radius;
-                        else
-                            colorRadius3 = (long double)(wheel_radius_center) * palet[z].L; // color distance from center
-                        long double angle3 = -Angle::NormalizedToRad(palet[z].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                        long double xOffset3 = wheel_center.x + cosf(angle3) * colorRadius3; // position from center of circle
-                        long double yOffset3 = wheel_center.y + sinf(angle3) * colorRadius3;
-
-                        // draw lines between the 3 dots : green with white inside
-                        cv::line(wheel_mask_analogous, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(0, 255, 0), 5, cv::LINE_AA);
-                        cv::line(wheel_mask_analogous, cv::Point(xOffset2, yOffset2), cv::Point(xOffset3, yOffset3), cv::Vec3b(0, 255, 0), 5, cv::LINE_AA);
-                        cv::line(wheel_mask_analogous, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                        cv::line(wheel_mask_analogous, cv::Point(xOffset2, yOffset2), cv::Point(xOffset3, yOffset3), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                        analogousFound = true;
-                    }
-            }
-            if (abs(120.0 - angles[x][y]) <= 25) { // triadic : 3 dots equally distanced => angle = 120°
-                // 1st dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius1 = wheel_radius;
-                else
-                    colorRadius1 = (long double)(wheel_radius_center) * palet[x].L; // color distance from center
-                long double angle1 = -Angle::NormalizedToRad(palet[x].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset1 = wheel_center.x + cosf(angle1) * colorRadius1; // position from center of circle
-                long double yOffset1 = wheel_center.y + sinf(angle1) * colorRadius1;
-                // 2nd dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius2 = wheel_radius;
-                else
-                    colorRadius2 = (long double)(wheel_radius_center) * palet[y].L; // color distance from center
-                long double angle2 = -Angle::NormalizedToRad(palet[y].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset2 = wheel_center.x + cosf(angle2) * colorRadius2; // position from center of circle
-                long double yOffset2 = wheel_center.y + sinf(angle2) * colorRadius2;
-
-                for (int z = 0; z < nb_palet; z++) // look for 3rd dot
-                    if ((z != x) and (z != y) and (abs(120.0 - angles[y][z]) <= 25) and (angles[x][z] > 90)) { // angle = 120°
-                        // 3rd dot coordinates
-                        if (ui->checkBox_color_borders->isChecked())
-                            colorRadius3 = wheel_radius;
-                        else
-                            colorRadius3 = (long double)(wheel_radius_center) * palet[z].L; // color distance from center
-                        long double angle3 = -Angle::NormalizedToRad(palet[z].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                        long double xOffset3 = wheel_center.x + cosf(angle3) * colorRadius3; // position from center of circle
-                        long double yOffset3 = wheel_center.y + sinf(angle3) * colorRadius3;
-
-                        // draw lines between the 3 dots : blue with white inside
-                        cv::line(wheel_mask_triadic, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 0, 0), 5, cv::LINE_AA);
-                        cv::line(wheel_mask_triadic, cv::Point(xOffset1, yOffset1), cv::Point(xOffset3, yOffset3), cv::Vec3b(255, 0, 0), 5, cv::LINE_AA);
-                        cv::line(wheel_mask_triadic, cv::Point(xOffset3, yOffset3), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 0, 0), 5, cv::LINE_AA);
-                        cv::line(wheel_mask_triadic, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                        cv::line(wheel_mask_triadic, cv::Point(xOffset1, yOffset1), cv::Point(xOffset3, yOffset3), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                        cv::line(wheel_mask_triadic, cv::Point(xOffset3, yOffset3), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                        triadicFound = true;
-                    }
-            }
-            if (abs(60.0 - angles[x][y]) <= 25) { // split-complementary : one dot with two opposites separated by ~60°
-                // 1st dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius1 = wheel_radius;
-                else
-                    colorRadius1 = (long double)(wheel_radius_center) * palet[x].L; // color distance from center
-                long double angle1 = -Angle::NormalizedToRad(palet[x].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset1 = wheel_center.x + cosf(angle1) * colorRadius1; // position from center of circle
-                long double yOffset1 = wheel_center.y + sinf(angle1) * colorRadius1;
-                // 2nd dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius2 = wheel_radius;
-                else
-                    colorRadius2 = (long double)(wheel_radius_center) * palet[y].L; // color distance from center
-                long double angle2 = -Angle::NormalizedToRad(palet[y].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset2 = wheel_center.x + cosf(angle2) * colorRadius2; // position from center of circle
-                long double yOffset2 = wheel_center.y + sinf(angle2) * colorRadius2;
-
-                for (int z = 0; z < nb_palet; z++) // looi for 3rd dot
-                    if ((z != x) and (z != y) and (abs(150.0 - angles[y][z]) <= 15) and (angles[x][z] > 130)) { // this time with angle ~150°
-                        // 3rd dot coordinates
-                        if (ui->checkBox_color_borders->isChecked())
-                            colorRadius3 = wheel_radius;
-                        else
-                            colorRadius3 = (long double)(wheel_radius_center) * palet[z].L; // color distance from center
-                        long double angle3 = -Angle::NormalizedToRad(palet[z].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                        long double xOffset3 = wheel_center.x + cosf(angle3) * colorRadius3; // position from center of circle
-                        long double yOffset3 = wheel_center.y + sinf(angle3) * colorRadius3;
-
-                        // draw lines between the dots : cyan with black inside
-                        cv::line(wheel_mask_split_complementary, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 255, 0), 5, cv::LINE_AA);
-                        cv::line(wheel_mask_split_complementary, cv::Point(xOffset1, yOffset1), cv::Point(xOffset3, yOffset3), cv::Vec3b(255, 255, 0), 5, cv::LINE_AA);
-                        cv::line(wheel_mask_split_complementary, cv::Point(xOffset3, yOffset3), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 255, 0), 5, cv::LINE_AA);
-                        cv::line(wheel_mask_split_complementary, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(0, 0, 0), 1, cv::LINE_AA);
-                        cv::line(wheel_mask_split_complementary, cv::Point(xOffset1, yOffset1), cv::Point(xOffset3, yOffset3), cv::Vec3b(0, 0, 0), 1, cv::LINE_AA);
-                        cv::line(wheel_mask_split_complementary, cv::Point(xOffset3, yOffset3), cv::Point(xOffset2, yOffset2), cv::Vec3b(0, 0, 0), 1, cv::LINE_AA);
-                        splitComplementaryFound = true;
-                    }
-            }
-            if (abs(60.0 - angles[x][y]) <= 25) { // tetradic : a rectangle of 2 pairs of complementary dots separated by ~60°
-                // 1st dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius1 = wheel_radius;
-                else
-                    colorRadius1 = (long double)(wheel_radius_center) * palet[x].L; // color distance from center
-                long double angle1 = -Angle::NormalizedToRad(palet[x].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset1 = wheel_center.x + cosf(angle1) * colorRadius1; // position from center of circle
-                long double yOffset1 = wheel_center.y + sinf(angle1) * colorRadius1;
-                // 2nd dot coordinatescv::LINE_AA
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius2 = wheel_radius;
-                else
-                    colorRadius2 = (long double)(wheel_radius_center) * palet[y].L; // color distance from center
-                long double angle2 = -Angle::NormalizedToRad(palet[y].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset2 = wheel_center.x + cosf(angle2) * colorRadius2; // position from center of circle
-                long double yOffset2 = wheel_center.y + sinf(angle2) * colorRadius2;
-
-                for (int z = 0; z < nb_palet; z++) // look for 3rd dot
-                    if ((z != x) and (z != y) and (abs(120.0 - angles[y][z]) <= 25) and (angles[z][x] > 140)) { // with an angle ~120°
-                        // 3rd dot coordinates
-                        if (ui->checkBox_color_borders->isChecked())
-                            colorRadius3 = wheel_radius;
-                        else
-                            colorRadius3 = (long double)(wheel_radius_center) * palet[z].L; // color distance from center
-                        long double angle3 = -Angle::NormalizedToRad(palet[z].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                        long double xOffset3 = wheel_center.x + cosf(angle3) * colorRadius3; // position from center of circle
-                        long double yOffset3 = wheel_center.y + sinf(angle3) * colorRadius3;
-
-                        for (int w = 0; w < nb_palet; w++) // look for 4th dot
-                            if ((w != x) and (w != y) and (w != z) and (abs(60.0 - angles[z][w]) <= 25) and (angles[y][w] > 140)) { // with an angle ~60°
-                                // 4th dot coordinates
-                                if (ui->checkBox_color_borders->isChecked())
-                                    colorRadius4 = wheel_radius;
-                                else
-                                    colorRadius4 = (long double)(wheel_radius_center) * palet[w].L; // color distance from center
-                                long double angle4 = -Angle::NormalizedToRad(palet[w].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                                long double xOffset4 = wheel_center.x + cosf(angle4) * colorRadius4; // position from center of circle
-                                long double yOffset4 = wheel_center.y + sinf(angle4) * colorRadius4;
-
-                                // draw lines between the dots : violet with white inside
-                                cv::line(wheel_mask_tetradic, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 0, 255), 5, cv::LINE_AA);
-                                cv::line(wheel_mask_tetradic, cv::Point(xOffset2, yOffset2), cv::Point(xOffset3, yOffset3), cv::Vec3b(255, 0, 255), 5, cv::LINE_AA);
-                                cv::line(wheel_mask_tetradic, cv::Point(xOffset3, yOffset3), cv::Point(xOffset4, yOffset4), cv::Vec3b(255, 0, 255), 5, cv::LINE_AA);
-                                cv::line(wheel_mask_tetradic, cv::Point(xOffset4, yOffset4), cv::Point(xOffset1, yOffset1), cv::Vec3b(255, 0, 255), 5, cv::LINE_AA);
-                                cv::line(wheel_mask_tetradic, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                                cv::line(wheel_mask_tetradic, cv::Point(xOffset2, yOffset2), cv::Point(xOffset3, yOffset3), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                                cv::line(wheel_mask_tetradic, cv::Point(xOffset3, yOffset3), cv::Point(xOffset4, yOffset4), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                                cv::line(wheel_mask_tetradic, cv::Point(xOffset4, yOffset4), cv::Point(xOffset1, yOffset1), cv::Vec3b(255, 255, 255), 1, cv::LINE_AA);
-                                tetradicFound = true;
-                            }
+        Y = window(x, 95, 145); // triadic : 3 dots equally distanced => angle = 120°
+        for (unsigned int i = 0; i < Y.size(); i++) {
+            const int y = Y[i];
+            if (abs(120.0 - angle(x, y)) > 25)
+                continue;
+            std::vector<int> Z = window(y, 95, 145); // 3rd dot : angle = 120°
+            for (unsigned int j = 0; j < Z.size(); j++)
+                if ((Z[j] != x) and (abs(120.0 - angle(y, Z[j])) <= 25) and (angle(x, Z[j]) > 90)) {
+                    segment(triadic, x, y);
+                    segment(triadic, x, Z[j]);
+                    segment(triadic, Z[j], y);
+                }
+        }
+
+        Y = window(x, 35, 85); // split-complementary and tetradic start with a ~60° angle
+        for (unsigned int i = 0; i < Y.size(); i++) {
+            const int y = Y[i];
+            if (abs(60.0 - angle(x, y)) > 25)
+                continue;
+            std::vector<int> Z = window(y, 135, 165); // split-complementary : one dot with two opposites separated by ~60°, 3rd dot with angle ~150°
+            for (unsigned int j = 0; j < Z.size(); j++)
+                if ((Z[j] != x) and (abs(150.0 - angle(y, Z[j])) <= 15) and (angle(x, Z[j]) > 130)) {
+                    segment(splitComplementary, x, y);
+                    segment(splitComplementary, x, Z[j]);
+                    segment(splitComplementary, Z[j], y);
+                }
+            Z = window(y, 95, 145); // tetradic : a rectangle of 2 pairs of complementary dots separated by ~60°, 3rd dot with an angle ~120°
+            for (unsigned int j = 0; j < Z.size(); j++) {
+                const int z = Z[j];
+                if ((z == x) or (abs(120.0 - angle(y, z)) > 25) or (angle(z, x) <= 140))
+                    continue;
+                std::vector<int> W = window(z, 35, 85); // 4th dot with an angle ~60°
+                for (unsigned int k = 0; k < W.size(); k++)
+                    if ((W[k] != x) and (W[k] != y) and (abs(60.0 - angle(z, W[k])) <= 25) and (angle(y, W[k]) > 140)) {
+                        segment(tetradic, x, y);
+                        segment(tetradic, y, z);
+                        segment(tetradic, z, W[k]);
+                        segment(tetradic, W[k], x);
                     }
             }
-            if (abs(90.0 - angles[x][y]) <= 25) { // square : almost the same as before, but all angles are equal ~90°
-                // 1st dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius1 = wheel_radius;
-                else
-                    colorRadius1 = (long double)(wheel_radius_center) * palet[x].L; // color distance from center
-                long double angle1 = -Angle::NormalizedToRad(palet[x].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                long double xOffset1 = wheel_center.x + cosf(angle1) * colorRadius1; // position from center of circle
-                long double yOffset1 = wheel_center.y + sinf(angle1) * colorRadius1;
-                // 2nd dot coordinates
-                if (ui->checkBox_color_borders->isChecked())
-                    colorRadius2 = wheel_radius;
-                else
-                    colorRadius2 = (long double)(wheel_radius_center) * palet[y].L; // color distance from center
-                long double angle2 = -Angle::NormalizedToRad(palet[y].H + 0.25); // aangle convert normalized value to radians + shift to have red on top
-                long double xOffset2 = wheel_center.x + cosf(angle2) * colorRadius2; // position from center of circle
-                long double yOffset2 = wheel_center.y + sinf(angle2) * colorRadius2;
-
-                for (int z = 0; z < nb_palet; z++) // look for 3rd dot
-                    if ((z != x) and (z != y) and (abs(90.0 - angles[y][z]) <= 25) and (angles[z][x] > 140)) { // angle ~90°
-                        // 3rd dot coordinates
-                        if (ui->checkBox_color_borders->isChecked())
-                            colorRadius3 = wheel_radius;
-                        else
-                            colorRadius3 = (long double)(wheel_radius_center) * palet[z].L; // color distance from center
-                        long double angle3 = -Angle::NormalizedToRad(palet[z].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                        long double xOffset3 = wheel_center.x + cosf(angle3) * colorRadius3; // position from center of circle
-                        long double yOffset3 = wheel_center.y + sinf(angle3) * colorRadius3;
-
-                        for (int w = 0; w < nb_palet; w++) // look for 4th dot
-                            if ((w != x) and (w != y) and (w != z) and (abs(90.0 - angles[z][w]) <= 25) and (angles[y][w] > 140)) { // angle ~90°
-                                // 4th dot coordinates
-                                if (ui->checkBox_color_borders->isChecked())
-                                    colorRadius4 = wheel_radius;
-                                else
-                                    colorRadius4 = (long double)(wheel_radius_center) * palet[w].L; // color distance from center
-                                long double angle4 = -Angle::NormalizedToRad(palet[w].H + 0.25); // angle convert normalized value to radians + shift to have red on top
-                                long double xOffset4 = wheel_center.x + cosf(angle4) * colorRadius4; // position from center of circle
-                                long double yOffset4 = wheel_center.y + sinf(angle4) * colorRadius4;
-
-                                // draw lines between the dots : orange with white inside
-                                cv::line(wheel_mask_square, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(0, 127, 255), 5, cv::LINE_AA);
-                                cv::line(wheel_mask_square, cv::Point(xOffset2, yOffset2), cv::Point(xOffset3, yOffset3), cv::Vec3b(0, 127, 255), 5, cv::LINE_AA);
-                                cv::line(wheel_mask_square, cv::Point(xOffset3, yOffset3), cv::Point(xOffset4, yOffset4), cv::Vec3b(0, 127, 255), 5, cv::LINE_AA);
-                                cv::line(wheel_mask_square, cv::Point(xOffset4, yOffset4), cv::Point(xOffset1, yOffset1), cv::Vec3b(0, 127, 255), 5, cv::LINE_AA);
-                                cv::line(wheel_mask_square, cv::Point(xOffset1, yOffset1), cv::Point(xOffset2, yOffset2), cv::Vec3b(0, 0, 0), 1, cv::LINE_AA);
-                                cv::line(wheel_mask_square, cv::Point(xOffset2, yOffset2), cv::Point(xOffset3, yOffset3), cv::Vec3b(0, 0, 0), 1, cv::LINE_AA);
-                                cv::line(wheel_mask_square, cv::Point(xOffset3, yOffset3), cv::Point(xOffset4, yOffset4), cv::Vec3b(0, 0, 0), 1, cv::LINE_AA);
-                                cv::line(wheel_mask_square, cv::Point(xOffset4, yOffset4), cv::Point(xOffset1, yOffset1), cv::Vec3b(0, 0, 0), 1, cv::LINE_AA);
-                                squareFound = true;
-                            }
+        }
+
+        Y = window(x, 65, 115); // square : almost the same as before, but all angles are equal ~90°
+        for (unsigned int i = 0; i < Y.size(); i++) {
+            const int y = Y[i];
+            if (abs(90.0 - angle(x, y)) > 25)
+                continue;
+            std::vector<int> Z = window(y, 65, 115); // 3rd dot : angle ~90°
+            for (unsigned int j = 0; j < Z.size(); j++) {
+                const int z = Z[j];
+                if ((z == x) or (abs(90.0 - angle(y, z)) > 25) or (angle(z, x) <= 140))
+                    continue;
+                std::vector<int> W = window(z, 65, 115); // 4th dot : angle ~90°
+                for (unsigned int k = 0; k < W.size(); k++)
+                    if ((W[k] != x) and (W[k] != y) and (abs(90.0 - angle(z, W[k])) <= 25) and (angle(y, W[k]) > 140)) {
+                        segment(square, x, y);
+                        segment(square, y, z);
+                        segment(square, z, W[k]);
+                        segment(square, W[k], x);
                     }
             }
         }
     }
 
+    bool complementaryFound = (std::find(complementary.begin(), complementary.end(), 1) != complementary.end()); // indicators of found color schemes
+    bool analogousFound = (std::find(analogous.begin(), analogous.end(), 1) != analogous.end());
+    bool triadicFound = (std::find(triadic.begin(), triadic.end(), 1) != triadic.end());
+    bool splitComplementaryFound = (std::find(splitComplementary.begin(), splitComplementary.end(), 1) != splitComplementary.end());
+    bool tetradicFound = (std::find(tetradic.begin(), tetradic.end(), 1) != tetradic.end());
+    bool squareFound = (std::find(square.begin(), square.end(), 1) != square.end());
+
     // check found color schemes in UI
     ui->pushButton_color_analogous->setChecked(analogousFound);
     ui->pushButton_color_complementary->setChecked(complementaryFound);
@@ -728,7 +617,8 @@ void MainWindow::on_button_analyze_clicked() // analyze image to find color sche
     }
 
     // cold and warm colors, blacks whites and grays, color stats. Here we work on the original image without filters
-    cv::Vec3b RGB;
+    stage.Next("statistics");
+    // counts only depend on pixel color : each unique color of the image is classified once, weighted by its number of pixels
     long double H, S, L;
     int countCold = 0; // number of "cold" pixels
     int countWarm = 0; // number of "warm" pixels
@@ -741,55 +631,58 @@ void MainWindow::on_button_analyze_clicked() // analyze image to find color sche
     double countP = 0; // sum of perceived brightness
     int countAll = image.rows * image.cols; // total number of pixels in image
     int stats[nb_color_sectors] = {0}; // count of 24 main hues in wheel
-
-    for (int x = 0; x < image.cols; x++) // parse image
-        for (int y = 0; y < image.rows; y++) {
-            RGB = image.at<cv::Vec3b>(y, x); // get current color
-            long double C, h;
-            HSLChfromRGB((long double)(RGB[2]) / 255.0, (long double)(RGB[1]) / 255.0, (long double)(RGB[0]) / 255.0, H, S, L, C, h); // HSLCh from pixel
-            H = Angle::NormalizedToDeg(H); // Hue in degrees
-            int hPrime = WhichColorSector(H); // get color sector for this pixel
-            double P = PerceivedBrightnessRGB(double(RGB[2]) / 255.0, double(RGB[1]) / 255.0, double(RGB[0]) / 255.0); // perceived brightness
-            countP += P; // total Perceived brightness
-            long double dBlack = DistanceFromBlackRGB((long double)(RGB[2]) / 255.0, (long double)(RGB[1]) / 255.0, (long double)(RGB[0]) / 255.0); // distances from black, white and gray
-            long double dWhite = DistanceFromWhiteRGB((long double)(RGB[2]) / 255.0, (long double)(RGB[1]) / 255.0, (long double)(RGB[0]) / 255.0);
-            long double dGray = DistanceFromGrayRGB((long double)(RGB[2]) / 255.0, (long double)(RGB[1]) / 255.0, (long double)(RGB[0]) / 255.0);
-
-            if (dBlack < blacksLimit) { // black is considered cold
-                countCold++;
+    achromaticCube cube = AchromaticClassificationCube(blacksLimit, whitesLimit, graysLimit); // blacks, whites and grays classification for current limits
+
+    std::vector<int> image_colors, image_counts; // histogram of image
+    int nb_image_colors = CountRGBUniqueValues(image, image_colors, image_counts); // unique colors of image with their number of pixels
+    for (int c = 0; c < nb_image_colors; c++) { // parse unique colors
+        const int R = (image_colors[c] >> 16) & 255; // current color
+        const int G = (image_colors[c] >> 8) & 255;
+        const int B = image_colors[c] & 255;
+        const int count = image_counts[c]; // number of pixels of this color
+        long double C, h;
+        HSLChfromRGB((long double)(R) / 255.0, (long double)(G) / 255.0, (long double)(B) / 255.0, H, S, L, C, h); // HSLCh from color
+        H = Angle::NormalizedToDeg(H); // Hue in degrees
+        int hPrime = WhichColorSector(H); // get color sector for this color
+        double P = PerceivedBrightnessRGB(double(R) / 255.0, double(G) / 255.0, double(B) / 255.0); // perceived brightness
+        countP += P * count; // total Perceived brightness
+        unsigned char flags = AchromaticClassification(cube, R, G, B); // distances from black, white and gray compared to limits
+
+        if (flags & achromatic_black) { // black is considered cold
+            countCold += count;
+        }
+        else { // color is not in blacks
+            if ((flags & achromatic_far_white) and (flags & achromatic_far_gray)) { // is it really a color ?
+                countColors += count; // more colored pixels
+                stats[hPrime] += count; // more colors in 12 colors stats
             }
-            else { // color is not in blacks
-                if ((dWhite > whitesLimit) and (dGray > graysLimit)) { // is it really a color ?
-                    countColors++; // one more color
-                    stats[hPrime]++; // one more color in 12 colors stats
-                }
-                // cold/warm
-                if ((dWhite > 5) and (dGray > 5)) { // nor too gray or too white
-                    if ((H > 80) and (H <= 150)) // neutral+
-                        countNeutralPlus++;
-                    else
-                    if ((H > 150) and (H <= 270)) // cold
-                        countCold++;
-                    else
-                    if ((H > 270) and (H <= 330)) // neutral-
-                        countNeutralMinus++;
-                    else
-                        countWarm++;
-                }
-                else { // poxel too white or too gray
-                    countCold++;
-                }
+            // cold/warm
+            if (flags & achromatic_far_pale) { // nor too gray or too white
+                if ((H > 80) and (H <= 150)) // neutral+
+                    countNeutralPlus += count;
+                else
+                if ((H > 150) and (H <= 270)) // cold
+                    countCold += count;
+                else
+                if ((H > 270) and (H <= 330)) // neutral-
+                    countNeutralMinus += count;
+                else
+                    countWarm += count;
+            }
+            else { // color too white or too gray
+                countCold += count;
             }
-
-            // increase black or white or gray counter
-            if (dBlack < blacksLimit) // blacks
-                countBlack++;
-            else if (dWhite < whitesLimit) // whites
-                countWhite++;
-            else if (dGray < graysLimit) // neutrals
-                countGray++;
         }
 
+        // increase black or white or gray counter
+        if (flags & achromatic_black) // blacks
+            countBlack += count;
+        else if (flags & achromatic_white) // whites
+            countWhite += count;
+        else if (flags & achromatic_gray) // neutrals
+            countGray += count;
+    }
+
     // cold/warm : compared to colored pixels only
     int maximum=std::max(std::max(std::max(countWarm,countCold), countNeutralPlus),countNeutralMinus); // which cold/warm value is the highest ?
     QString coldAndWarm; // for display
@@ -888,6 +781,7 @@ void MainWindow::on_button_analyze_clicked() // analyze image to find color sche
     ui->label_color_brightness->setText(brightness + QString::number(countP / countAll * 100.0, 'f', 1) + "%"); // show result
 
     // graph
+    stage.Next("rendering");
     if (countColors > 0) { // colors found ?
         ui->color_graph->setVisible(true); // graph is visible
         int w = ui->color_graph->width(); // width and height of graph
@@ -925,9 +819,12 @@ void MainWindow::on_button_analyze_clicked() // analyze image to find color sche
 
     // show Analyze frame and Color wheel
     ui->frame_analysis->setVisible(true); // show analysis frame
-    OverlayWheel(); // show Wheel layers
+    ComputeWheelOverlay(); // draw found color schemes lines
+    ShowWheel(); // show Wheel with hues of analyzed colors and layers
+    stage.Stop();
 
     ShowTimer(false); // show elapsed time
+    ShowTimings(); // show stages timings
     QApplication::restoreOverrideCursor(); // Restore cursor
 }
 
@@ -937,6 +834,9 @@ void MainWindow::mousePressEvent(QMouseEvent *eventPress) // event triggered by
 {
     mouseButton = eventPress->button(); // mouse button value
 
+    if ((mouseButton == Qt::LeftButton) and (ui->timer->underMouse())) // timer clicked : show/hide timings panel
+        timings_dock->setVisible(!timings_dock->isVisible());
+
     if (mouseButton == Qt::RightButton) { // right mouse button ?
         if ((ui->label_image->underMouse()) or (ui->label_quantized->underMouse())) { // over Image or Quantized ?
             zoom = !zoom; // change zoom
@@ -1028,14 +928,13 @@ void MainWindow::mousePressEvent(QMouseEvent *eventPress) // event triggered by
         }
 
         ShowResults(); // show images
-        ShowWheel(); // show Wheel
-        OverlayWheel(); // show Wheel layers
+        ShowWheel(); // show Wheel and its layers
     }
 }
 
 void MainWindow::wheelEvent(QWheelEvent *wheelEvent) // mouse wheel turned
 {
-    if (!computed)
+    if ((!computed) or (computing)) // nothing to show, or circle size slider disabled
         return;// get out
 
     int n = wheelEvent->delta(); // amount of wheel turn
@@ -1085,7 +984,11 @@ void MainWindow::on_button_load_image_clicked() // load image to analyze
     ChangeBaseDir(filename); // save current path to ini file
 
     std::string filesession = filename.toUtf8().constData(); // base file name
+    profile_load = struct_profile(); // new timings
+    ProfileActive profile_active(profile_load); // record load and preprocess stages
+    ProfileStage stage("load");
     image = cv::imread(filesession); // load image
+    stage.Stop();
     if (image.empty()) {
         QMessageBox::critical(this, "File error", "There was a problem reading the image file");
         return;
@@ -1096,18 +999,22 @@ void MainWindow::on_button_load_image_clicked() // load image to analyze
 
     ui->label_filename->setText(filename); // display file name in ui
 
-    if (ui->checkBox_gaussian_blur->isChecked()) // gaussian blur ?
-        cv::GaussianBlur(image, image, cv::Size(3,3), 0, 0); // blur image
-    if (ui->checkBox_reduce_size->isChecked()) // reduce size ?
-        if ((image.rows > 512) or (image.cols > 512)) image = ResizeImageAspectRatio(image, cv::Size(512,512)); // resize image
+    image = PreprocessImage(image, ui->checkBox_gaussian_blur->isChecked(), ui->checkBox_reduce_size->isChecked()); // gaussian blur and reduce size
+    profile_compute = struct_profile(); // timings of previous image are obsolete
+    profile_analyze = struct_profile();
+    ShowTimings();
 
     quantized.release(); // no quantized image yet
+    quantized_colors.clear(); // no histogram either
+    quantized_counts.clear();
     palette.release(); // no palette image yet
 
     zoom = false; // no zoom by default
     pickedColor = cv::Vec3b(-1, -1, -1); // reset picked color
     ShowResults(); // show images in GUI
     nb_palettes = -1; // no palette to show
+    scheme_colors.clear(); // no color schemes either
+    ComputeWheelOverlay();
     ShowWheel(); // display wheel
 
     // reset GUI elements
@@ -1318,39 +1225,12 @@ void MainWindow::on_button_save_clicked() // save all results
 
 /////////////////// Core functions //////////////////////
 
-void MainWindow::ComputePaletteValues(const int n) // compute palette values from RGB for one color
-{
-    HSLChfromRGB((long double)(palettes[n].R / 255.0), (long double)(palettes[n].G / 255.0), (long double)(palettes[n].B / 255.0),
-               palettes[n].H, palettes[n].S, palettes[n].L, palettes[n].C, palettes[n].h); // get H, S and L
-
-    // hexadecimal value
-    QString hex;
-    if (palettes[n].R == -1) // not a plaette color, set it to 000000 because some filters use this to take out this color
-        hex = "000000";
-    else
-        hex = QString(" %1").arg(((palettes[n].R & 0xff) << 16)
-                                   + ((palettes[n].G & 0xff) << 8)
-                                   +  (palettes[n].B & 0xff)
-                                     , 6, 16, QChar('0')).trimmed(); // compute hexa RGB value
-    hex = "#" + hex; // add a hash character
-    palettes[n].hexa = hex.toUpper().toUtf8().constData(); // save hex value
-
-    // distances to black, white and gray points, computed with CIEDE2000 distance algorithm
-    palettes[n].distanceBlack = DistanceFromBlackRGB(palettes[n].R / 255.0, palettes[n].G / 255.0, palettes[n].B / 255.0);
-    palettes[n].distanceWhite = DistanceFromWhiteRGB(palettes[n].R / 255.0, palettes[n].G / 255.0, palettes[n].B / 255.0);
-    palettes[n].distanceGray = DistanceFromGrayRGB(palettes[n].R / 255.0, palettes[n].G / 255.0, palettes[n].B / 255.0);
-}
-
 void MainWindow::ComputePaletteImage() // compute palette image from palettes values
 {
     // compute percentages
     int total = 0; // total number of pixels
     for (int n = 0; n < nb_palettes; n++) { // for each color in palette
-        cv::Mat1b mask; // current color mask
-        cv::inRange(quantized, cv::Vec3b(palettes[n].B, palettes[n].G, palettes[n].R),
-                           cv::Vec3b(palettes[n].B, palettes[n].G, palettes[n].R),
-                           mask); // create mask for current color
-        palettes[n].count = cv::countNonZero(mask); // count pixels in this mask
+        palettes[n].count = CountRGBValue(quantized_colors, quantized_counts, palettes[n].R, palettes[n].G, palettes[n].B); // count pixels of this color in Quantized histogram
         total += palettes[n].count; // increase total number of pixels
     }
     for (int n = 0; n < nb_palettes; n++) // for each color in palette
@@ -1418,403 +1298,176 @@ void MainWindow::SortPalettes() // sort palette values and create palette image
 
 void MainWindow::FindColorName(const int &n_palette) // find color name for one palette item
 {
-    bool found = false;
-    long double distance = 1000000; // distance from nearest color
-    int index = 0; // to keep nearest color index in color names table
-
-    for (int c = 0; c < nb_color_names; c++) { // search in color names table
-        if ((palettes[n_palette].R == color_names[c].R) and (palettes[n_palette].G == color_names[c].G) and (palettes[n_palette].B == color_names[c].B)) { // same RGB values found
-            palettes[n_palette].name = color_names[c].name; // assign color name to color in palette
-            found = true; // color found in color names database
-            break; // get out of loop
-        }
-        else { // exact color not found
-            long double d = DistanceRGB((long double)(palettes[n_palette].R) / 255.0, (long double)(palettes[n_palette].G) / 255.0, (long double)(palettes[n_palette].B) / 255.0,
-                                        (long double)(color_names[c].R) / 255.0, (long double)(color_names[c].G) / 255.0, (long double)(color_names[c].B) / 255.0,
-                                        1.0, 0.5, 1.0); // CIEDE2000 distance with emphasis on Lightness
-            if (d < distance) { // if distance is smaller than before
-                distance = d; // new distance
-                index = c; // keep index
-            }
-        }
-    }
-    if (!found) // picked color not found in palette so display nearest color
-        palettes[n_palette].name = color_names[index].name; // assign color name
+    palettes[n_palette].name = QString::fromStdString(NearestColorName(color_names, palettes[n_palette].R, palettes[n_palette].G, palettes[n_palette].B)); // exact or nearest color name
 }
 
 void MainWindow::Compute() // analyze image dominant colors
 {
-    if (!loaded) { // nothing loaded yet = get out
+    if ((!loaded) or (computing)) { // nothing loaded yet or already computing = get out
         return;
     }
 
-    QApplication::setOverrideCursor(Qt::WaitCursor); // wait cursor
+    struct_dominant_params params; // pipeline parameters from GUI
+    if (ui->radioButton_mean_shift->isChecked()) // algorithm
+        params.algorithm = algorithm_mean_shift;
+    else if (ui->radioButton_eigen_vectors->isChecked())
+        params.algorithm = algorithm_eigen_vectors;
+    else if (ui->radioButton_k_means->isChecked())
+        params.algorithm = algorithm_k_means;
+    else
+        params.algorithm = algorithm_sectored_means;
+    params.nb_colors = ui->spinBox_nb_palettes->value(); // how many dominant colors
+    params.filter_grays = ui->checkBox_filter_grays->isChecked(); // filters
+    params.blacks_limit = blacksLimit;
+    params.grays_limit = graysLimit;
+    params.whites_limit = whitesLimit;
+    params.regroup = ui->checkBox_regroup->isChecked();
+    params.regroup_distance = ui->horizontalSlider_regroup_distance->value();
+    params.filter_percent = ui->checkBox_filter_percent->isChecked();
+    params.filter_percentage = ui->horizontalSlider_filter_percentage->value();
+    params.mean_shift_spatial = ui->horizontalSlider_mean_shift_spatial->value(); // algorithms options
+    params.mean_shift_color = ui->horizontalSlider_mean_shift_color->value();
+    params.sectored_means_levels = ui->checkBox_sectored_means_levels->isChecked();
+    params.sectored_means_nb_levels = ui->horizontalSlider_sectored_means_levels->value();
+
+    // start compute worker : the GUI stays responsive
+    computing = true;
+    ui->button_compute->setEnabled(false); // only one computation at a time
+    ui->button_load_image->setEnabled(false); // image must not change while computing
+    EnableResults(false); // previous palette and quantized image are obsolete
+    QApplication::setOverrideCursor(Qt::BusyCursor); // busy cursor, GUI still usable
     timer.start(); // reinit timer
     ShowTimer(true); // show it
-    qApp->processEvents();
-
-    cv::Mat imageCopy; // work on a copy of the image, because gray colors can be filtered
-    image.copyTo(imageCopy);
-
-    long double H, S, L;
-    if (ui->checkBox_filter_grays->isChecked()) { // filter whites, blacks and grays if gray filter is set
-        cv::Vec3b RGB;
-        for (int x = 0; x < imageCopy.cols; x++) // parse temp image
-            for  (int y = 0; y < imageCopy.rows; y++) {
-                RGB = imageCopy.at<cv::Vec3b>(y, x); // current pixel color
-                long double C, h;
-                HSLChfromRGB(double(RGB[2] / 255.0), double(RGB[1] / 255.0), double(RGB[0] / 255.0), H, S, L, C, h); // get HSL values
-                long double dBlack = DistanceFromBlackRGB((long double)(RGB[2]) / 255.0, (long double)(RGB[1]) / 255.0, (long double)(RGB[0]) / 255.0); // compute distances from black, white and gray points
-                long double dWhite = DistanceFromWhiteRGB((long double)(RGB[2]) / 255.0, (long double)(RGB[1]) / 255.0, (long double)(RGB[0]) / 255.0);
-                long double dGray = DistanceFromGrayRGB((long double)(RGB[2]) / 255.0, (long double)(RGB[1]) / 255.0, (long double)(RGB[0]) / 255.0);
-
-                if ((dGray < graysLimit) or (dBlack < blacksLimit) or (dWhite < whitesLimit)) // white or black or gray pixel ?
-                    imageCopy.at<cv::Vec3b>(y, x) = cv::Vec3b(0, 0, 0); // replace it with black in temp image
-            }
-    }
-
-    nb_palettes= ui->spinBox_nb_palettes->value(); // how many dominant colors
-    int nb_palettes_asked = nb_palettes; // save asked number of colors for later
-    ui->spinBox_nb_palettes->setStyleSheet("QSpinBox{color:black;background-color: white;}"); // show number of colors in black (in case it was red before)
-
-    if (ui->checkBox_filter_grays->isChecked()) { // if grays and blacks and whites are filtered
-        cv::Mat1b black_mask;
-        cv::inRange(imageCopy, cv::Vec3b(0, 0, 0), cv::Vec3b(0, 0, 0), black_mask); // extract black pixels from image (= whites and blacks and grays)
-        if ((cv::sum(black_mask) != cv::Scalar(0,0,0))) // image contains black pixels ?
-            nb_palettes++; // add one color to asked number of colors in palette, to remove it later and only get colors
-    }
-
-    // set all palette values to dummy values
-    for (int n = 0; n < nb_palettes_max; n++) {
-        palettes[n].R = -1;
-        palettes[n].G = -1;
-        palettes[n].B = -1;
-        palettes[n].count = -1;
-        palettes[n].percentage = -1;
-        palettes[n].distanceBlack = 0;
-        palettes[n].distanceWhite = 100;
-        palettes[n].distanceGray = 100;
-        palettes[n].name = "Not computed";
-    }
-
-    int totalMean = 0; // number of colors obtained with Mean algorithms (mean-shift and sectored-means)
-
-    if (ui->radioButton_mean_shift->isChecked()) { // mean-shift algorithm checked : intermediate number of colors unknown
-        cv::Mat temp = ImgRGBtoLab(imageCopy); // convert image to CIELab
-
-        MeanShift MSProc(ui->horizontalSlider_mean_shift_spatial->value(), ui->horizontalSlider_mean_shift_color->value()); // create instance of Mean-shift
-        MSProc.MeanShiftFilteringCIELab(temp); // Mean-shift filtering
-        MSProc.MeanShiftSegmentationCIELab(temp); // Mean-shift segmentation
-        quantized = ImgLabToRGB(temp); // convert image back to RGB
-
-        // palette from quantized image
-        struct struct_colors { // color index and count
-            cv::Vec3b RGB;
-            int count;
+    live_timer.start(100); // refresh elapsed time every 100 ms
+    ShowComputeProgress(0);
+
+    // big images are quantized band by band : no full size copies (CIELab, filtered...) - mean-shift needs the whole image
+    const bool tiled = ((long long)(image.rows) * image.cols > tiledPixelsMin) and (params.algorithm != algorithm_mean_shift);
+    cv::Mat source = tiled ? image : image.clone(); // the worker has its own copy of the image - tiled mode only reads it, and it can't be changed while computing
+    profile_compute = struct_profile(); // new timings
+    profile_analyze = struct_profile(); // analyze of previous palette is obsolete
+    compute_result = struct_dominant_result(); // nothing left from previous computation
+    compute_error.clear();
+    compute_watcher.setFuture(QtConcurrent::run([this, source, params, tiled]() {
+        compute_profile = struct_profile(); // only the worker uses it until ComputeFinished : GUI can show and save the other profiles meanwhile
+        ProfileActive profile_active(compute_profile); // stages are recorded by the worker thread
+        dominantProgress progress = [this](const int &percent) {
+            QMetaObject::invokeMethod(this, "ShowComputeProgress", Qt::QueuedConnection, Q_ARG(int, percent)); // progress shown by GUI thread
         };
-        int nb_count = CountRGBUniqueValues(quantized); // number of colors in quantized image : we don't know how many
-        struct_colors color[nb_count]; // temp palette
-
-        int nbColor = 0;
-        for (int x = 0; x < quantized.cols; x++) // parse quantized image
-            for (int y = 0; y < quantized.rows; y++) {
-                cv::Vec3b col = quantized.at<cv::Vec3b>(y, x); // current pixel
-                bool found = false; // indicates if color was known
-                for (int i = 0; i < nbColor; i++) // parse colors index
-                    if (col == color[i].RGB) { // if color already registered
-                        found = true; // we found it !
-                        color[i].count++; // add 1 pixel to the count of this color
-                        break; // stop
-                    }
-                if (!found) { // if color was not found
-                    color[nbColor].RGB = col; // add it to the index
-                    color[nbColor].count = 1; // 1 pixel found for the moment
-                    nbColor++; // increase number of colors found
-                }
-            }
-        std::sort(color, color + nbColor,
-                  [](const struct_colors& a, const struct_colors& b) {return a.count > b.count;}); // sort colors by count, descending
-
-        int total = quantized.rows * quantized.cols; // number of pixels in image
-        // clean insignificant colors by percentage
-        while ((nbColor > 1) and (double(color[nbColor - 1].count) / total < 0.005)) // is the last color percentage an insignificant value ?
-            nbColor--; // one less color to consider
-
-        if (nbColor > nb_count) // number of asked colors could be inferior to the real number of colors in quantized image
-            nbColor = nb_count;
-        nb_palettes = nbColor; // real number of colors in palette
-
-        for (int n = 0; n < nbColor; n++) { // for all colors in Mean-shift palette
-            palettes[n].R = color[n].RGB[2]; // copy RGB values to global palette
-            palettes[n].G = color[n].RGB[1];
-            palettes[n].B = color[n].RGB[0];
-            totalMean += color[n].count; // compute total number of pixels for this color
+        try { // errors are reported by ComputeFinished : QtConcurrent would only keep them in the future
+            if ((!tiled) or (!ComputeDominantColorsTiled(source.rows, source.cols, MatBandReader(source), TiledBandRows(source.cols, tiled_memory_default),
+                                                         params, color_names, compute_result, dominantBandWriter(), progress))) // tiled mode failed : whole image
+                ComputeDominantColors(source, params, color_names, compute_result, progress); // compute dominant colors
         }
-    }
-    else if (ui->radioButton_eigen_vectors->isChecked()) { // eigen method : number of colors known from the start
-        cv::Mat conv = ImgRGBtoLab(imageCopy); // convert image to CIELab
-        cv::Mat result;
-        std::vector<cv::Vec3f> temp;
-        temp = DominantColorsEigenCIELab(conv, nb_palettes, result); // get dominant palette, palette image and quantized image
-
-        quantized = ImgLabToRGB(result); // convert Quantized back to RGB
-
-        // palette from quantized image
-        cv::Vec3b color[nb_palettes]; // temp palette
-        int nbColor = 0; // current color
-        for (int x = 0; x < quantized.cols; x++) // parse entire image
-            for (int y = 0; y < quantized.rows; y++) {
-                cv::Vec3b col = quantized.at<cv::Vec3b>(y, x); // current pixel color
-                bool found = false;
-                for (int i = 0; i < nbColor; i++) // look into temp palette
-                    if (col == color[i]) { // if color already exists
-                        found = true; // found, don't add it
-                        break;
-                    }
-                if (!found) { // color not already in temp palette
-                    color[nbColor] = col; // save new color
-                    palettes[nbColor].R = col[2]; // copy RGB values to global palette
-                    palettes[nbColor].G = col[1];
-                    palettes[nbColor].B = col[0];
-                    nbColor++; // one more color
-                }
-            }
-    }
-    else if (ui->radioButton_k_means->isChecked()) { // K-means algorithm : number of colors known from the start
-        cv::Mat1f colors; // store palette from K-means
-        quantized = DominantColorsKMeansCIELAB(imageCopy, nb_palettes, colors); // get quantized image and palette
-
-        // palette from quantized image
-        cv::Vec3b color[nb_palettes]; // temp palette
-        int nbColor = 0; // current color
-        for (int x = 0; x < quantized.cols; x++) // parse entire image
-            for (int y = 0; y < quantized.rows; y++) {
-                cv::Vec3b col = quantized.at<cv::Vec3b>(y, x); // current pixel color
-                bool found = false;
-                for (int i = 0; i < nbColor; i++) // look into temp palette
-                    if (col == color[i]) { // if color already exists
-                        found = true; // found, don't add it
-                        break;
-                    }
-                if (!found) { // color not already in temp palette
-                    color[nbColor] = col; // save new color
-                    palettes[nbColor].R = col[2]; // copy RGB values to global palette
-                    palettes[nbColor].G = col[1];
-                    palettes[nbColor].B = col[0];
-                    nbColor++; // one more color
-                }
-            }
-    }
-    else if (ui->radioButton_sectored_means->isChecked()) { // sectored-means : intermediate number of colors unknown
-        if (ui->checkBox_sectored_means_levels->isChecked()) // choice of Chroma and Lightness levels ?
-            SectoredMeansSegmentationLevels(imageCopy, ui->horizontalSlider_sectored_means_levels->value(), quantized); // get sectored-means quantized with choice of levels
-        else
-            SectoredMeansSegmentationCategories(imageCopy, quantized); // get sectored-means quantized without choice of levels
-
-        // palette from quantized image
-        struct struct_colors { // sgtruct for color index and count
-            cv::Vec3b RGB;
-            int count;
-        };
-        int nb_count = CountRGBUniqueValues(quantized); // number of colors in quantized image : we don't know how many
-        if (nb_palettes > nb_palettes_max) // limit number of colors to consider
-            nb_palettes = nb_palettes_max;
-        struct_colors color[nb_count]; // temp palette
-
-        int nbColor = 0;
-        for (int x = 0; x < quantized.cols; x++) // parse quantized image
-            for (int y = 0; y < quantized.rows; y++) {
-                cv::Vec3b col = quantized.at<cv::Vec3b>(y, x);
-                bool found = false; // indicates if color was known
-                for (int i = 0; i < nbColor; i++) // parse colors index
-                    if (col == color[i].RGB) { // if color already registered
-                        found = true; // we found it !
-                        color[i].count++; // add 1 pixel to the count of this color
-                        break; // stop
-                    }
-                if (!found) { // if color was not found
-                    color[nbColor].RGB = col; // add it to the index
-                    color[nbColor].count = 1; // 1 pixel found for the moment
-                    nbColor++; // increase number of colors found
-                }
-            }
-
-        std::sort(color, color + nbColor,
-                  [](const struct_colors& a, const struct_colors& b) {return a.count > b.count;}); // sort colors by count, descending
-
-        int total = quantized.rows * quantized.cols; // number of pixels in image
-        // delete insignificant colors
-        while ((nbColor > 1) and (double(color[nbColor - 1].count) / total < 0.005)) // is the last color percentage an insignificant value ?
-            nbColor--; // one less color to consider
-
-        if (nbColor > nb_count) // number of asked colors could be inferior to the real number of colors in quantized image
-            nbColor = nb_count;
-        if (nbColor > nb_palettes_max) // number of colors must not be superior to max number of colors in palette
-            nbColor = nb_palettes_max;
-        nb_palettes = nbColor; // real number of colors to consider
-
-        for (int n = 0; n < nbColor; n++) { // for all colors in Mean-shift palette
-            palettes[n].R = color[n].RGB[2]; // copy RGB values to global palette
-            palettes[n].G = color[n].RGB[1];
-            palettes[n].B = color[n].RGB[0];
-            totalMean += color[n].count; // compute total number of pixels for this color
+        catch (const std::bad_alloc &) { // most likely with big images
+            compute_error = "Not enough memory to quantize this image";
         }
-    }
-
-    // compute HSL values from RGB + hexa + distances
-    for (int n = 0; n < nb_palettes; n++) // for each color in palette
-        ComputePaletteValues(n); // compute values other than RGB
-
-    // clean palette : number of asked colors may be superior to number of colors found
-    int nb_real = CountRGBUniqueValues(quantized); // how many colors in quantized image, really ?
-    if (nb_real < nb_palettes) { // if asked number of colors exceeds total number of colors in image
-        std::sort(palettes, palettes + nb_palettes,
-                  [](const struct_palette& a, const struct_palette& b) {return a.hexa > b.hexa;}); // sort palette by hexa value, decending
-        if (((palettes[0].R == palettes[1].R) and (palettes[0].G == palettes[1].G)
-                and (palettes[0].B == palettes[1].B)) or (palettes[0].R == -1)) // if first color in palette is equal to second or it's a dummy color -> we have to reverse sort
-            std::sort(palettes, palettes + nb_palettes,
-                      [](const struct_palette& a, const struct_palette& b) {return a.hexa > b.hexa;}); // sort the palette, this time by increasing hexa values
-        nb_palettes = nb_real; // new number of colors in palette
-    }
-
-    int total; // total number of pixels to consider for percentages
-    if ((ui->radioButton_mean_shift->isChecked()) or (ui->radioButton_sectored_means->isChecked())) // particular case of mean algorithms
-        total = totalMean; // total is the mean total computed before
-    else // not mean algorithm
-        total= quantized.rows * quantized.cols; // total is the size of quantized image in pixels
-
-    // delete blacks in palette if "filter grays" enabled because there really can be one blackish color in the quantized image that could have been mixed with others
-    if (ui->checkBox_filter_grays->isChecked()) { // delete last "black" values in palette
-        bool black_found = false;
-        std::sort(palettes, palettes + nb_palettes,
-              [](const struct_palette& a, const struct_palette& b) {return a.distanceBlack > b.distanceBlack;}); // sort palette by distance from black, descending
-        while ((nb_palettes > 1) and (palettes[nb_palettes - 1].distanceBlack < blacksLimit)) { // at the end of palette, find black colors
-            cv::Mat1b black_mask;
-            cv::inRange(quantized, cv::Vec3b(palettes[nb_palettes - 1].B, palettes[nb_palettes - 1].G, palettes[nb_palettes - 1].R),
-                               cv::Vec3b(palettes[nb_palettes - 1].B, palettes[nb_palettes - 1].G, palettes[nb_palettes - 1].R),
-                               black_mask); // extract this black color from image in a mask
-            int c = countNonZero(black_mask); // how many pixels are black ?
-            total = total - c; // update total pixel count
-            palettes[nb_palettes - 1]. R = -1; // exclude this black color from palette
-            nb_palettes--; // one less color in palette
-            if (c > 0) // really found black color ?
-                black_found = true; // black color found !
+        catch (const std::exception &error) { // cv::Exception too
+            compute_error = error.what();
         }
-        if (black_found) { // if black color found
-            ui->spinBox_nb_palettes->setValue(nb_palettes); // show new number of colors without black values
+        catch (...) {
+            compute_error = "Unknown error";
         }
-    }
-
-    // compute percentages (NOT the final value)
-    for (int n = 0; n < nb_palettes; n++) { // for each color in palette
-        cv::Mat1b mask; // current color mask
-        cv::inRange(quantized, cv::Vec3b(palettes[n].B, palettes[n].G, palettes[n].R),
-                           cv::Vec3b(palettes[n].B, palettes[n].G, palettes[n].R),
-                           mask); // create mask for current color
-        palettes[n].count = cv::countNonZero(mask); // count pixels in this mask
-        palettes[n].percentage = (long double)(palettes[n].count) / (long double)(total); // compute color percentage in image
-    }
+    }));
+}
 
-    // regroup near colors
-    if (ui->checkBox_regroup->isChecked()) { // is "regroup colors" enabled ?
-        bool regroup = false; // if two colors are regrouped this will be true
-        for (int n = 0; n < nb_palettes; n++) // parse palette
-            for (int i = 0; i < nb_palettes; i++) { // parse the same palette to compare values
-                if ((n !=i) and (palettes[n].R + palettes[n].G + palettes[n].B != 0) and (palettes[i].R + palettes[i].G + palettes[i].B != 0)
-                        and (palettes[n].R > 0) and (palettes[i].R > 0)) { // exlude same color index and black values and dummy colors
-                    long double d = DistanceRGB((long double)palettes[n].R / 255.0, (long double)palettes[n].G / 255.0, (long double)palettes[n].B / 255.0,
-                                                (long double)palettes[i].R / 255.0, (long double)palettes[i].G / 255.0, (long double)palettes[i].B / 255.0,
-                                                1.0, 0.5, 1.0); // distance with less for chroma
-                    if (d < ui->horizontalSlider_regroup_distance->value()) { // check if the two colors are near ("regroup" filter distance)
-                        long double R, G, B;
-                        RGBMean((long double)palettes[n].R / 255.0, (long double)palettes[n].G / 255.0, (long double)palettes[n].B / 255.0, palettes[n].count,
-                                (long double)palettes[i].R / 255.0, (long double)palettes[i].G / 255.0, (long double)palettes[i].B / 255.0, palettes[i].count,
-                                R, G, B); // the new color is the RGB mean of the two colors
-
-                        // change quantized image
-                        cv::Mat mask1;
-                        cv::inRange(quantized, cv::Vec3b(palettes[n].B, palettes[n].G, palettes[n].R),
-                                           cv::Vec3b(palettes[n].B, palettes[n].G, palettes[n].R),
-                                           mask1); // extract first color n from image
-                        quantized.setTo(cv::Vec3b(round(B * 255.0), round(G * 255.0), round(R * 255.0)), mask1); // replace pixels with new color in Quantized
-                        cv::Mat mask2; // do the same for the second i color
-                        cv::inRange(quantized, cv::Vec3b(palettes[i].B, palettes[i].G, palettes[i].R),
-                                           cv::Vec3b(palettes[i].B, palettes[i].G, palettes[i].R),
-                                           mask2); // extract second color i from image
-                        quantized.setTo(cv::Vec3b(round(B * 255.0), round(G * 255.0), round(R * 255.0)), mask2); // replace pixels with new color in Quantized
-
-                        // new palette values
-                        palettes[n].R = round(R * 255.0); // replace colors in palette n with new color values
-                        palettes[n].G = round(G * 255.0);
-                        palettes[n].B = round(B * 255.0);
-                        palettes[n].count += palettes[i].count; // merge the two colors count
-                        palettes[n].percentage += palettes[i].percentage; // and merge the percentage too
-                        ComputePaletteValues(n); // compute new palette values other than RGB
-
-                        // palette has changed
-                        palettes[i].R = -1; // dummy value (important, it excludes this color now from the algorithm)
-                        regroup = true; // at least one color regroup was found
-                    }
-                }
-            }
-        if (regroup) { // at least one color regroup was found so palette has changed
-            std::sort(palettes, palettes + nb_palettes,
-                      [](const struct_palette& a, const struct_palette& b) {return a.R > b.R;}); // sort palette by hexa value, descending
-            while ((nb_palettes > 1) and (palettes[nb_palettes - 1].R == -1)) // look for excluded colors
-                nb_palettes--; // update palette count
-        }
-    }
+void MainWindow::EnableResults(const bool &enable) // enable or disable controls that use the palette and quantized image
+{
+    ui->frame_rgb->setEnabled(enable); // palette : save, add and delete colors, sort, scale
+    ui->frame_analyze->setEnabled(enable); // analyze, color schemes, save graph
+    ui->verticalSlider_circle_size->setEnabled(enable); // wheel drawn from palette
+    ui->button_save->setEnabled(enable); // save buttons
+    ui->button_save_wheel->setEnabled(enable);
+    ui->button_save_quantized->setEnabled(enable);
+}
 
-    nb_palettes_found = nb_palettes; // max number of colors found, keep it
+void MainWindow::ShowComputeProgress(int percent) // called by compute worker : show progress
+{
+    ui->button_compute->setText(QString(" QUANTIZE %1%").arg(percent)); // progress in compute button
+}
 
-    // delete non significant values in palette by percentage
-    if (ui->checkBox_filter_percent->isChecked()) { // filter by x% enabled ?
-        bool cleaning_found = false; // indicator
-        std::sort(palettes, palettes + nb_palettes,
-              [](const struct_palette& a, const struct_palette& b) {return a.percentage > b.percentage;}); // sort palette by percentage, descending
-        while ((nb_palettes > 1) and (palettes[nb_palettes - 1].percentage * 100 < ui->horizontalSlider_filter_percentage->value())) { // at the end of palette, find colors < x% of image
-            cv::Mat1b cleaning_mask;
-            cv::inRange(quantized, cv::Vec3b(palettes[nb_palettes - 1].B, palettes[nb_palettes - 1].G, palettes[nb_palettes - 1].R),
-                               cv::Vec3b(palettes[nb_palettes - 1].B, palettes[nb_palettes - 1].G, palettes[nb_palettes - 1].R),
-                               cleaning_mask); // extract this color from image
-            int c = cv::countNonZero(cleaning_mask); // count occurences of this color
-            total = total - c; // update total pixel count
-            nb_palettes--; // exclude this color from palette
-            if (c > 0) // really found this color ?
-                cleaning_found = true; // palettes count has changed
-        }
-        if (cleaning_found) { // if cleaning found
-            ui->spinBox_nb_palettes->setValue(nb_palettes); // show new number of colors without cleaned values
-            // re-compute percentages
-            for (int n = 0; n < nb_palettes; n++) // for each color in palette
-                palettes[n].percentage = (long double)(palettes[n].count) / (long double)(total); // update percentage with new total
-        }
-    }
+void MainWindow::ShowLiveTimer() // called by live timer while computing : show elapsed time
+{
+    ShowTimer(false);
+}
 
-    // find color name by CIEDE2000 distance for all palette
-    for (int n = 0; n < nb_palettes; n++) { // for each color in palette
-        FindColorName(n); // find its name
+void MainWindow::ComputeFinished() // called when compute worker has finished : show results
+{
+    live_timer.stop(); // stop refreshing elapsed time
+    computing = false;
+    ui->button_compute->setText(" QUANTIZE"); // restore GUI
+    ui->button_compute->setEnabled(true);
+    ui->button_load_image->setEnabled(true);
+    EnableResults(true);
+
+    struct_dominant_result &result = compute_result; // pipeline result
+    profile_compute = std::move(compute_profile); // worker timings
+
+    if (!compute_error.empty()) { // worker failed : previous palette and quantized image are kept
+        result = struct_dominant_result(); // partial result is not used
+        ShowTimer(false); // show elapsed time
+        ShowTimings();
+        QApplication::restoreOverrideCursor(); // restore cursor before message
+        QMessageBox::critical(this, "Quantize failed", QString::fromStdString(compute_error));
+        return;
     }
 
-    if (nb_palettes < 1) // at least one color in palette !
-        nb_palettes = 1;
-    if (palettes[nb_palettes -1].R == -1) { // if the only color in palette is a dummy one
-        palettes[nb_palettes -1].R = 0; // "paint it black" !
-        palettes[nb_palettes -1].G = 0;
-        palettes[nb_palettes -1].B = 0;
+    // copy result to GUI palette
+    quantized = result.quantized; // quantized image
+    quantized_colors.swap(result.histogram_colors); // and its histogram
+    quantized_counts.swap(result.histogram_counts);
+    nb_palettes = result.nb_colors; // number of colors in palette
+    nb_palettes_found = result.palette.size(); // max number of colors found
+    int nb_palettes_asked = result.nb_asked; // asked number of colors
+    for (int n = 0; n < nb_palettes_max; n++) { // for each color in palette
+        if (n < nb_palettes_found) { // color found
+            palettes[n].R = result.palette[n].R; // copy values
+            palettes[n].G = result.palette[n].G;
+            palettes[n].B = result.palette[n].B;
+            palettes[n].H = result.palette[n].H;
+            palettes[n].S = result.palette[n].S;
+            palettes[n].L = result.palette[n].L;
+            palettes[n].C = result.palette[n].C;
+            palettes[n].h = result.palette[n].h;
+            palettes[n].distanceBlack = result.palette[n].distanceBlack;
+            palettes[n].distanceWhite = result.palette[n].distanceWhite;
+            palettes[n].distanceGray = result.palette[n].distanceGray;
+            palettes[n].hexa = result.palette[n].hexa;
+            palettes[n].count = result.palette[n].count;
+            palettes[n].percentage = result.palette[n].percentage;
+            if (result.palette[n].name.empty()) // color name not computed yet
+                palettes[n].name = "Not computed";
+            else
+                palettes[n].name = QString::fromStdString(result.palette[n].name);
+        }
+        else { // set all other palette values to dummy values
+            palettes[n].R = -1;
+            palettes[n].G = -1;
+            palettes[n].B = -1;
+            palettes[n].count = -1;
+            palettes[n].percentage = -1;
+            palettes[n].distanceBlack = 0;
+            palettes[n].distanceWhite = 100;
+            palettes[n].distanceGray = 100;
+            palettes[n].name = "Not computed";
+        }
     }
-    if (nb_palettes > nb_palettes_asked) // limit number of colors to asked number of colors
-        nb_palettes = nb_palettes_asked;
 
+    ProfileActive profile_active(profile_compute); // record GUI stages
+    ProfileStage stage("rendering");
     ResetSort(); // reset combo box to default (percentage) without activating it
     ComputePaletteImage(); // create palette image
 
     zoom = false; // no zoom for Image and Quantized
     pickedColor = cv::Vec3b(-1, -1, -1); // dummy values
+    scheme_colors.clear(); // color schemes of previous palette are obsolete
+    ComputeWheelOverlay();
     ShowWheel(); // display color wheel
     ShowResults(); // show result images
+    stage.Stop();
 
     ShowTimer(false); // show elapsed time
+    ShowTimings(); // show stages timings
     QApplication::restoreOverrideCursor(); // Restore cursor
 
     computed = true; // success !
@@ -1934,7 +1587,7 @@ void MainWindow::ShowResults() // display result images in GUI
     }
 }
 
-void MainWindow::DrawOnWheelBorder(const int &R, const int &G, const int &B, const int &radius, const bool &center) // draw one color disk on Wheel border
+void MainWindow::DrawOnWheelBorder(cv::Mat &layer, const int &R, const int &G, const int &B, const int &radius, const bool &center) // draw one color disk on Wheel border
 {
     long double H, S, L, C, h; // HSL values
     HSLChfromRGB(double(R) / 255.0, double(G) / 255.0, double(B) / 255.0, H, S, L, C, h); // convert RGB to HSL values (L and S are from CIELab)
@@ -1943,10 +1596,36 @@ void MainWindow::DrawOnWheelBorder(const int &R, const int &G, const int &B, con
     long double xOffset = cosf(angle) * wheel_radius; // position from center of circle
     long double yOffset = sinf(angle) * wheel_radius;
 
-    cv::circle(wheel, cv::Point(wheel_center.x + xOffset, wheel_center.y + yOffset), radius, cv::Vec3b(B, G, R), -1, cv::LINE_AA); // draw color disk
-    cv::circle(wheel, cv::Point(wheel_center.x + xOffset, wheel_center.y + yOffset), radius, cv::Vec3b(255,255,255), 2, cv::LINE_AA); // draw white border
+    cv::circle(layer, cv::Point(wheel_center.x + xOffset, wheel_center.y + yOffset), radius, cv::Vec3b(B, G, R), -1, cv::LINE_AA); // draw color disk
+    cv::circle(layer, cv::Point(wheel_center.x + xOffset, wheel_center.y + yOffset), radius, cv::Vec3b(255,255,255), 2, cv::LINE_AA); // draw white border
     if (center) // draw black center ?
-        cv::circle(wheel, cv::Point(wheel_center.x + xOffset, wheel_center.y + yOffset), radius, cv::Vec3b(0,0,0), -1, cv::LINE_AA); // draw black center disk
+        cv::circle(layer, cv::Point(wheel_center.x + xOffset, wheel_center.y + yOffset), radius, cv::Vec3b(0,0,0), -1, cv::LINE_AA); // draw black center disk
+}
+
+cv::Point MainWindow::SchemeDotPosition(const long double &H, const long double &L, const bool &border) // position on wheel of a color dot used by color schemes
+{
+    long double colorRadius; // radius of color dot on the wheel
+    if (border) // draw on dot or external circle ?
+        colorRadius = wheel_radius; // external circle
+    else
+        colorRadius = (long double)(wheel_radius_center) * L; // color distance from center
+    long double angle = -Angle::NormalizedToRad(H + 0.25); // angle convert normalized value to radians + shift to have red on top
+    long double xOffset = wheel_center.x + cosf(angle) * colorRadius; // position from center of circle
+    long double yOffset = wheel_center.y + sinf(angle) * colorRadius;
+    return cv::Point(xOffset, yOffset);
+}
+
+void MainWindow::DrawSchemeSegments(cv::Mat &mask, const std::vector<uchar> &segments, const std::vector<cv::Point> &dots, const cv::Vec3b &color, const cv::Vec3b &inside) // draw color scheme lines between dots
+{
+    const int nb = dots.size(); // segments is a nb * nb matrix, only a < b is used
+    for (int a = 0; a < nb; a++) // thick lines first
+        for (int b = a + 1; b < nb; b++)
+            if (segments[a * nb + b])
+                cv::line(mask, dots[a], dots[b], color, 5, cv::LINE_AA);
+    for (int a = 0; a < nb; a++) // then thin lines inside, not hidden by other thick lines
+        for (int b = a + 1; b < nb; b++)
+            if (segments[a * nb + b])
+                cv::line(mask, dots[a], dots[b], inside, 1, cv::LINE_AA);
 }
 
 void MainWindow::DrawOnWheel(const int &R, const int &G, const int &B, const int &radius, const bool &border) // draw one color disk on Wheel
@@ -1966,39 +1645,46 @@ void MainWindow::DrawOnWheel(const int &R, const int &G, const int &B, const int
                    cv::Vec3b(255, 255, 255), 2, cv::LINE_AA); // draw border
 }
 
-void MainWindow::ShowWheel() // display color wheel
+void MainWindow::DrawWheelBackground() // draw static layer of color wheel : only depends on wheel size
 {
-    wheel = cv::Mat::zeros(ui->label_wheel->height(), ui->label_wheel->width(), CV_8UC3); // empty wheel image
-    wheel = cv::Vec3b(192,192,192); // background is light gray
+    wheel_background = cv::Mat::zeros(ui->label_wheel->height(), ui->label_wheel->width(), CV_8UC3); // empty wheel image
+    wheel_background = cv::Vec3b(192,192,192); // background is light gray
 
     // size and center
-    wheel_center = cv::Point(wheel.cols / 2, wheel.rows / 2); // center of wheel
-    wheel_radius = wheel.cols / 2 - 50; // radius of outer circle (Primary Secondary and Tertiary colors)
+    wheel_center = cv::Point(wheel_background.cols / 2, wheel_background.rows / 2); // center of wheel
+    wheel_radius = wheel_background.cols / 2 - 50; // radius of outer circle (Primary Secondary and Tertiary colors)
     wheel_radius_center = wheel_radius - 70; // inner circles for image palette
 
     // circles
-    cv::circle(wheel, wheel_center, wheel_radius, cv::Vec3b(255, 255, 255), 2,  cv::LINE_AA); // outer circle
-    cv::circle(wheel, wheel_center, wheel_radius_center, cv::Vec3b(200, 200, 200), 2,  cv::LINE_AA); // inner circle
+    cv::circle(wheel_background, wheel_center, wheel_radius, cv::Vec3b(255, 255, 255), 2,  cv::LINE_AA); // outer circle
+    cv::circle(wheel_background, wheel_center, wheel_radius_center, cv::Vec3b(200, 200, 200), 2,  cv::LINE_AA); // inner circle
     // circle center (a cross)
-    cv::line(wheel, cv::Point(wheel_center.x, wheel_center.y - 10), cv::Point(wheel_center.x, wheel_center.y + 10), cv::Vec3b(255,255,255), 1); // vertical line
-    cv::line(wheel, cv::Point(wheel_center.x - 10, wheel_center.y), cv::Point(wheel_center.x + 10, wheel_center.y), cv::Vec3b(255,255,255), 1); // horizontal line
+    cv::line(wheel_background, cv::Point(wheel_center.x, wheel_center.y - 10), cv::Point(wheel_center.x, wheel_center.y + 10), cv::Vec3b(255,255,255), 1); // vertical line
+    cv::line(wheel_background, cv::Point(wheel_center.x - 10, wheel_center.y), cv::Point(wheel_center.x + 10, wheel_center.y), cv::Vec3b(255,255,255), 1); // horizontal line
 
     // draw Primary, Secondary and Tertiary color disks on wheel
     // Primary = biggest circles
-    DrawOnWheelBorder(255,0,0,40,false); // red
-    DrawOnWheelBorder(0,255,0,40,false); // green
-    DrawOnWheelBorder(0,0,255,40,false); // blue
+    DrawOnWheelBorder(wheel_background, 255,0,0,40,false); // red
+    DrawOnWheelBorder(wheel_background, 0,255,0,40,false); // green
+    DrawOnWheelBorder(wheel_background, 0,0,255,40,false); // blue
     // Secondary
-    DrawOnWheelBorder(255,255,0,30,false); // yellow
-    DrawOnWheelBorder(255,0,255,30,false); // magenta
-    DrawOnWheelBorder(0,255,255,30,false); // cyan
+    DrawOnWheelBorder(wheel_background, 255,255,0,30,false); // yellow
+    DrawOnWheelBorder(wheel_background, 255,0,255,30,false); // magenta
+    DrawOnWheelBorder(wheel_background, 0,255,255,30,false); // cyan
     // Tertiary
-    DrawOnWheelBorder(255,127,0,20,false); // orange
-    DrawOnWheelBorder(255,0,127,20,false); // pink
-    DrawOnWheelBorder(127,0,255,20,false); // purple
-    DrawOnWheelBorder(0,127,255,20,false); // azure
-    DrawOnWheelBorder(0,255,127,20,false); // aquamarine
-    DrawOnWheelBorder(127,255,0,20,false); // chartreuse
+    DrawOnWheelBorder(wheel_background, 255,127,0,20,false); // orange
+    DrawOnWheelBorder(wheel_background, 255,0,127,20,false); // pink
+    DrawOnWheelBorder(wheel_background, 127,0,255,20,false); // purple
+    DrawOnWheelBorder(wheel_background, 0,127,255,20,false); // azure
+    DrawOnWheelBorder(wheel_background, 0,255,127,20,false); // aquamarine
+    DrawOnWheelBorder(wheel_background, 127,255,0,20,false); // chartreuse
+}
+
+void MainWindow::ShowWheel() // display color wheel : palette layer drawn on cached static layer, then color schemes layer
+{
+    if ((wheel_background.cols != ui->label_wheel->width()) or (wheel_background.rows != ui->label_wheel->height())) // first call or wheel resized ?
+        DrawWheelBackground(); // static layer is only drawn again for a new size
+    wheel_background.copyTo(wheel); // start from static layer - no reallocation if same size
 
     // Draw palette disks : size = percentage of use in quantized image
     for (int n = 0; n < nb_palettes;n++) { // for each color in palette
@@ -2006,9 +1692,16 @@ void MainWindow::ShowWheel() // display color wheel
         DrawOnWheel(palettes[n].R, palettes[n].G,palettes[n].B, round(palettes[n].percentage * 100.0), border); // draw color disk
     }
 
-    wheel.copyTo(wheel_result); // copy result to Wheel image cache for displaying layers on it, later
+    // draw hues of analyzed colors on wheel external circle
+    for (unsigned int n = 0; n < scheme_colors.size(); n++) { // parse colors kept for color schemes
+        long double S = 1; // max chroma and normal lightness
+        long double L = 0.5;
+        long double R, G, B;
+        HSLtoRGB(scheme_colors[n].H, S, L, R, G, B); // convert maxed current hue to RGB
+        DrawOnWheelBorder(wheel, int(round(R * 255.0)), int(round(G * 255.0)), int(round(B * 255.0)), 10, true); // draw a black dot on external circle of wheel
+    }
 
-    ui->label_wheel->setPixmap(Mat2QPixmap(wheel)); // update Wheel view
+    OverlayWheel(); // add color schemes layer and update Wheel view
 }
 
 void MainWindow::ShowTimer(const bool start) // time elapsed
@@ -2024,8 +1717,68 @@ void MainWindow::ShowTimer(const bool start) // time elapsed
     }
 }
 
+void MainWindow::ShowTimings() // show stages timings and counters in timings panel
+{
+    timings_tree->clear(); // new values
+
+    const struct_profile *profiles[3] = {&profile_load, &profile_compute, &profile_analyze}; // last load, quantize and analyze
+    const QString titles[3] = {"Load", "Quantize", "Analyze"};
+    struct_profile all; // for counters
+    for (int p = 0; p < 3; p++) { // each profile is a group of stages
+        if (profiles[p]->stages.empty()) // nothing recorded
+            continue;
+        ProfileAppend(all, *profiles[p]);
+
+        std::vector<struct_profile_stage> stages = profiles[p]->stages; // stages are recorded when they end : sort them by start, parents first
+        std::sort(stages.begin(), stages.end(), [](const struct_profile_stage &a, const struct_profile_stage &b) {
+            return (a.start < b.start) or ((a.start == b.start) and (a.depth < b.depth));
+        });
+        long long total = 0; // total time of group = top stages
+        for (unsigned int s = 0; s < stages.size(); s++)
+            if (stages[s].depth == 0)
+                total += stages[s].duration;
+
+        QTreeWidgetItem *group = new QTreeWidgetItem(timings_tree, QStringList() << titles[p] << QString::number(total / 1000.0, 'f', 1) << "100.0");
+        std::vector<QTreeWidgetItem*> parents(1, group); // parents[depth] = parent of stages at this depth
+        for (unsigned int s = 0; s < stages.size(); s++) {
+            int depth = std::min(stages[s].depth, int(parents.size()) - 1); // current parent
+            parents.resize(depth + 1); // deeper stages are finished
+            QTreeWidgetItem *item = new QTreeWidgetItem(parents[depth], QStringList() << QString::fromStdString(stages[s].name)
+                                                                                       << QString::number(stages[s].duration / 1000.0, 'f', 1)
+                                                                                       << QString::number(total > 0 ? 100.0 * stages[s].duration / total : 0, 'f', 1));
+            parents.push_back(item); // parent of next deeper stages
+        }
+    }
+
+    if (!all.counters.empty()) { // algorithm counters
+        QTreeWidgetItem *group = new QTreeWidgetItem(timings_tree, QStringList() << "Counters");
+        for (unsigned int c = 0; c < all.counters.size(); c++)
+            new QTreeWidgetItem(group, QStringList() << QString::fromStdString(all.counters[c].name) << QString::number(all.counters[c].value));
+    }
+
+    timings_tree->expandAll(); // all stages visible, groups can be collapsed
+}
+
+void MainWindow::SaveTrace() // save timings as Chrome trace-event JSON
+{
+    struct_profile profile; // last load, quantize and analyze together
+    ProfileAppend(profile, profile_load);
+    ProfileAppend(profile, profile_compute);
+    ProfileAppend(profile, profile_analyze);
+    if (profile.stages.empty()) { // nothing timed yet = get out
+        QMessageBox::critical(this, "Nothing to do!", "You have to load, compute or analyze an image before saving timings");
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this, "Save trace file", QString::fromStdString(basedir + basefile + "-trace.json"), tr("JSON (*.json)")); // trace filename
+    if (filename.isNull() || filename.isEmpty()) // cancel ?
+        return;
+
+    if (!SaveProfileTrace(filename.toUtf8().constData(), profile)) // open it in chrome://tracing or ui.perfetto.dev
+        QMessageBox::critical(this, "File error", "There was a problem writing the trace file");
+}
+
 void MainWindow::SetCircleSize(int size) // called when circle size slider is moved
 {
-    ShowWheel(); // this changes the Wheel view
-    OverlayWheel(); // draw Wheel overlays, again
+    ShowWheel(); // only palette layer is drawn again, static and color schemes layers are cached
 }
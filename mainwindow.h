@@ -20,8 +20,15 @@
 #include <QMainWindow>
 #include <QFileDialog>
 #include <QTime>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QDockWidget>
+#include <QTreeWidget>
 
 #include "color-spaces.h"
+#include "color-names.h"
+#include "dominant-colors-pipeline.h"
+#include "profiler.h"
 
 namespace Ui {
 class MainWindow;
@@ -38,6 +45,10 @@ public:
 public slots:
     void ShowTimer(const bool start); // elapsed time
     void SetCircleSize(int size); // called when circle size slider is moved
+    void ShowComputeProgress(int percent); // called by compute worker : show progress
+    void ShowLiveTimer(); // called by live timer while computing : show elapsed time
+    void ComputeFinished(); // called when compute worker has finished : show results
+    void SaveTrace(); // save timings as Chrome trace-event JSON
 
 private slots:
 
@@ -92,21 +103,26 @@ private:
     //// Display
     void ShowResults(); // display thumbnail, quantized image, palette
     void ShowWheel(); // display color wheel
+    void DrawWheelBackground(); // draw static layer of color wheel
+    void ComputeWheelOverlay(); // draw enabled color schemes layer
     void OverlayWheel(); // draw layers on wheel
     void DrawOnWheel(const int &R, const int &G, const int &B, const int &radius, const bool &border); // draw one color on color wheel
-    void DrawOnWheelBorder(const int &R, const int &G, const int &B, const int &radius, const bool &center); // draw one color on color wheel border
+    void DrawOnWheelBorder(cv::Mat &layer, const int &R, const int &G, const int &B, const int &radius, const bool &center); // draw one color on color wheel border
+    cv::Point SchemeDotPosition(const long double &H, const long double &L, const bool &border); // position on wheel of a color dot used by color schemes
+    void DrawSchemeSegments(cv::Mat &mask, const std::vector<uchar> &segments, const std::vector<cv::Point> &dots, const cv::Vec3b &color, const cv::Vec3b &inside); // draw color scheme lines between dots
 
     //// Mouse & Keyboard
     void mousePressEvent(QMouseEvent *eventPress); // mouse clic events
     void wheelEvent(QWheelEvent *wheelEvent); // mouse wheel turned
 
     //// General
-    void ComputePaletteValues(const int n); // compute palette values from RGB for one color
     void ComputePaletteImage(); // compute palette image from palettes values
     void SortPalettes(); // sort palette values
     void ResetSort(); // reset combo box to default (percentage) without activating it
     void FindColorName(const int &n_palette); // find color name for one palette item
-    void Compute(); // compute dominant colors
+    void Compute(); // compute dominant colors - starts compute worker
+    void EnableResults(const bool &enable); // enable or disable controls that use the palette and quantized image - disabled while computing
+    void ShowTimings(); // show stages timings and counters in timings panel
 
     //// Variables
 
@@ -122,16 +138,14 @@ private:
             quantized, // quantized image
             palette, // palette image
             graph; // graph image
-    cv::Mat wheel_mask_complementary,
-            wheel_mask_split_complementary,
-            wheel_mask_analogous,
-            wheel_mask_triadic,
-            wheel_mask_tetradic,
-            wheel_mask_square;
+    std::vector<int> quantized_colors, quantized_counts; // histogram of quantized image - see CountRGBUniqueValues
 
     // color wheel
     cv::Point wheel_center; // wheel center
     int wheel_radius, wheel_radius_center; // wheel radius
+    cv::Mat wheel_background, // static layer : circles and reference colors, only drawn again when wheel size changes
+            wheel_overlay; // enabled color schemes layer, added to wheel
+    cv::Rect wheel_overlay_area; // part of wheel where color schemes lines are drawn
 
     // mouse
     Qt::MouseButton mouseButton; // mouse button value
@@ -157,17 +171,13 @@ private:
     cv::Vec3b pickedColor; // clicked color in palette
 
     // color names
-    struct struct_color_names { // structure of color name
-        int R; // RGB values in [0..255]
-        int G;
-        int B;
-        QString name; // color name
-    };
-    struct_color_names color_names[10000]; // 9000+ values in CSV files
-    int nb_color_names; // total number of color name values
+    struct_color_names color_names; // 9000+ values in CSV file, with CIELab index
 
     // analyze
-    long double angles[nb_palettes_max][nb_palettes_max]; // Hue angles difference between colors in palette
+    std::vector<struct_palette> scheme_colors; // colors kept by Analyze for color schemes
+    bool scheme_borders; // color schemes lines drawn between dots on external circle
+    std::vector<uchar> scheme_complementary, scheme_split_complementary, scheme_analogous,
+                       scheme_triadic, scheme_tetradic, scheme_square; // segments of each color scheme between scheme colors, see DrawSchemeSegments
     long double blacksLimit, whitesLimit, graysLimit; // limits for determining blacks, grays and whites values
     const long double blacksLimitIni = 18; // default parameters values in GUI
     const long double graysLimitIni = 9;
@@ -177,9 +187,23 @@ private:
     const long double nbMeanShiftSpatialIni = 4;
     const long double nbMeanShiftColorIni = 12;
     const long double nbSectoredMeansLevels = 3;
+    const long long tiledPixelsMin = 24000000; // bigger images are quantized band by band, without full size copies
 
     // timer
     QTime timer; // elapsed time
+    QTimer live_timer; // refresh elapsed time while computing
+
+    // timings
+    struct_profile profile_load, profile_compute, profile_analyze; // stages and counters of last load, compute and analyze
+    QDockWidget *timings_dock; // timings panel, shown by clicking on timer
+    QTreeWidget *timings_tree; // stages and counters
+
+    // compute worker
+    QFutureWatcher<void> compute_watcher; // signals the end of computing thread
+    struct_dominant_result compute_result; // result of computing thread
+    struct_profile compute_profile; // timings recorded by computing thread - moved to profile_compute when it has finished
+    std::string compute_error; // why computing thread failed - empty = success
+    bool computing; // indicator: compute worker running
 
     // other items
     bool zoom; // for source and quantized images
@@ -19,17 +19,22 @@
  *
 #-------------------------------------------------*/
 
+#ifdef QT_GUI_LIB // Qt conversions only when built with Qt GUI (not in headless library)
 #include <QPixmap>
+#endif
 
 #include "opencv2/opencv.hpp"
 
 #include "mat-image-tools.h"
 #include "angles.h"
 #include "color-spaces.h"
+#include "color-spaces-kernels.h"
 
 using namespace std;
 using namespace cv;
 
+#ifdef QT_GUI_LIB
+
 ///////////////////////////////////////////////////////////
 //// Conversions from QImage and QPixmap to Mat
 ///////////////////////////////////////////////////////////
@@ -146,6 +151,8 @@ QImage cvMatToQImage(const Mat &source) // another implementation BGR to RGB, ev
     return QImage(); // return empty Mat if type not found
 }
 
+#endif // QT_GUI_LIB
+
 ///////////////////////////////////////////////////////////
 //// Brightness, Contrast, Gamma, Equalize, Balance
 ///////////////////////////////////////////////////////////
@@ -670,16 +677,150 @@ Mat AnaglyphTint(const Mat & source, const int &tint) // change tint of image to
 
 //// Number of colors in image
 
+int NbRowBands(const cv::Mat &image) // number of row bands for parallel processing of image
+{
+    return std::max(1, std::min(image.rows, cv::getNumThreads())); // one band per thread
+}
+
 int CountRGBUniqueValues(const cv::Mat &image) // count number of RGB colors in image
+{ // one bit for each of the 2^24 RGB values : 2 MB bitmap per band
+    const int nb_words = (1 << 24) / 64; // bitmap size in 64-bit words
+    const int nb_bands = NbRowBands(image); // each band has its own bitmap
+    std::vector<std::vector<uint64_t>> bitmaps(nb_bands);
+
+    cv::parallel_for_(cv::Range(0, nb_bands), [&](const cv::Range &range) {
+        for (int band = range.start; band < range.end; band++) {
+            std::vector<uint64_t> &bitmap = bitmaps[band]; // bitmap of this band
+            bitmap.assign(nb_words, 0);
+            for (int y = image.rows * band / nb_bands; y < image.rows * (band + 1) / nb_bands; y++) { // rows of band
+                const Vec3b *row = image.ptr<Vec3b>(y); // assumes CV_8UC3 !
+                for (int x = 0; x < image.cols; x++) {
+                    int n = (row[x][2] << 16) | (row[x][1] << 8) | row[x][0]; // "hash" representation of the pixel
+                    bitmap[n >> 6] |= uint64_t(1) << (n & 63); // set bit of this RGB value
+                }
+            }
+        }
+    });
+
+    int count = 0; // merge bitmaps and count bits set
+    for (int w = 0; w < nb_words; w++) {
+        uint64_t word = 0;
+        for (int band = 0; band < nb_bands; band++)
+            word |= bitmaps[band][w];
+        for (; word; count++) // count bits set
+            word &= word - 1;
+    }
+
+    return count;
+}
+
+void RadixSortRGB(std::vector<int> &keys) // sort 24-bit RGB values : 3 passes of 8 bits
 {
-    std::set<int> unique;
+    std::vector<int> temp(keys.size()); // sorted values of current pass
+    for (int shift = 0; shift < 24; shift += 8) { // least significant byte first
+        int offsets[257] = {0}; // position of each byte value in sorted array
+        for (size_t i = 0; i < keys.size(); i++)
+            offsets[((keys[i] >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++)
+            offsets[b + 1] += offsets[b];
+        for (size_t i = 0; i < keys.size(); i++)
+            temp[offsets[(keys[i] >> shift) & 0xFF]++] = keys[i];
+        keys.swap(temp);
+    }
+}
 
-    for (Vec3b &p : cv::Mat_<Vec3b>(image)) { // iterate over pixels (assummes CV_8UC3 !)
-        int n = (p[0] << 16) | (p[1] << 8) | (p[2]); // "hash" representation of the pixel
-        unique.insert(n);
+int CountRGBUniqueValues(const cv::Mat &image, std::vector<int> &colors, std::vector<int> &counts) // count number of RGB colors in image and get histogram
+{ // each band is radix-sorted then run-length encoded, and the band histograms are merged
+    const int nb_bands = NbRowBands(image);
+    std::vector<std::vector<int>> band_colors(nb_bands), band_counts(nb_bands); // histogram of each band
+
+    cv::parallel_for_(cv::Range(0, nb_bands), [&](const cv::Range &range) {
+        for (int band = range.start; band < range.end; band++) {
+            const int row_begin = image.rows * band / nb_bands; // rows of band
+            const int row_end = image.rows * (band + 1) / nb_bands;
+            std::vector<int> keys; // all pixels of band as int
+            keys.reserve((row_end - row_begin) * image.cols);
+            for (int y = row_begin; y < row_end; y++) {
+                const Vec3b *row = image.ptr<Vec3b>(y); // assumes CV_8UC3 !
+                for (int x = 0; x < image.cols; x++)
+                    keys.push_back((row[x][2] << 16) | (row[x][1] << 8) | row[x][0]); // "hash" representation of the pixel
+            }
+            RadixSortRGB(keys); // same colors are now together
+
+            for (size_t i = 0; i < keys.size(); i++) // run-length of sorted pixels
+                if ((band_colors[band].empty()) or (band_colors[band].back() != keys[i])) { // new color
+                    band_colors[band].push_back(keys[i]);
+                    band_counts[band].push_back(1);
+                }
+                else
+                    band_counts[band].back()++; // one more pixel for this color
+        }
+    });
+
+    colors.swap(band_colors[0]); // merge band histograms, both are sorted
+    counts.swap(band_counts[0]);
+    for (int band = 1; band < nb_bands; band++) {
+        std::vector<int> merged_colors, merged_counts;
+        merged_colors.reserve(colors.size() + band_colors[band].size());
+        merged_counts.reserve(colors.size() + band_colors[band].size());
+        size_t i = 0, j = 0;
+        while ((i < colors.size()) or (j < band_colors[band].size())) {
+            if ((j == band_colors[band].size()) or ((i < colors.size()) and (colors[i] < band_colors[band][j]))) { // only in first
+                merged_colors.push_back(colors[i]);
+                merged_counts.push_back(counts[i++]);
+            }
+            else if ((i == colors.size()) or (band_colors[band][j] < colors[i])) { // only in second
+                merged_colors.push_back(band_colors[band][j]);
+                merged_counts.push_back(band_counts[band][j++]);
+            }
+            else { // in both
+                merged_colors.push_back(colors[i]);
+                merged_counts.push_back(counts[i++] + band_counts[band][j++]);
+            }
+        }
+        colors.swap(merged_colors);
+        counts.swap(merged_counts);
     }
 
-    return unique.size();
+    return colors.size();
+}
+
+int CountRGBValue(const std::vector<int> &colors, const std::vector<int> &counts, const int &R, const int &G, const int &B) // number of pixels of one color in histogram
+{
+    if ((R < 0) or (G < 0) or (B < 0)) // dummy color
+        return 0;
+
+    const int key = (R << 16) | (G << 8) | B; // same "hash" as CountRGBUniqueValues
+    std::vector<int>::const_iterator it = std::lower_bound(colors.begin(), colors.end(), key); // colors are sorted
+    if ((it == colors.end()) or (*it != key)) // color not in histogram
+        return 0;
+    return counts[it - colors.begin()];
+}
+
+void ReplaceRGBValues(cv::Mat &image, const std::vector<int> &from, const std::vector<int> &to) // replace colors in image in one pass
+{
+    if (from.empty()) // nothing to replace
+        return;
+
+    const int nb_bands = NbRowBands(image);
+    cv::parallel_for_(cv::Range(0, nb_bands), [&](const cv::Range &range) {
+        for (int band = range.start; band < range.end; band++) {
+            int last_key = -1, last_index = -1; // last color seen : neighbor pixels often have the same color
+            for (int y = image.rows * band / nb_bands; y < image.rows * (band + 1) / nb_bands; y++) {
+                Vec3b *row = image.ptr<Vec3b>(y); // assumes CV_8UC3 !
+                for (int x = 0; x < image.cols; x++) {
+                    const int key = (row[x][2] << 16) | (row[x][1] << 8) | row[x][0]; // "hash" representation of the pixel
+                    if (key != last_key) { // new color : look for it
+                        std::vector<int>::const_iterator it = std::lower_bound(from.begin(), from.end(), key); // from is sorted
+                        last_key = key;
+                        last_index = ((it != from.end()) and (*it == key)) ? int(it - from.begin()) : -1; // -1 = not replaced
+                    }
+                    if (last_index >= 0) // replace color
+                        row[x] = Vec3b(to[last_index] & 255, (to[last_index] >> 8) & 255, (to[last_index] >> 16) & 255);
+                }
+            }
+        }
+    });
 }
 
 //// Conversions of images to other colors spaces
@@ -687,17 +828,41 @@ int CountRGBUniqueValues(const cv::Mat &image) // count number of RGB colors in
 cv::Mat ImgRGBtoLab(const cv::Mat &source) // convert RGB image to CIELab
 {
     cv::Mat temp(source.rows, source.cols, CV_32FC3); // CIELab "image" values
-    cv::Vec3b color;
-    long double X, Y, Z, L, a, b;
-    for (int x = 0; x < source.cols; x++) // parse image
-        for  (int y = 0; y < source.rows; y++) {
-            color = source.at<cv::Vec3b>(y, x); // current pixel
-            RGBtoXYZ((long double)color[2] / 255.0, (long double)color[1] / 255.0, (long double)color[0] / 255.0, X, Y, Z); // convert RGB to XYZ
-            XYZtoLAB(X, Y, Z, L, a, b); // convert XYZ to CIELab
-            temp.at<cv::Vec3f>(y, x)[0] = float(L); // write CIELab values to temp image
-            temp.at<cv::Vec3f>(y, x)[1] = float(a);
-            temp.at<cv::Vec3f>(y, x)[2] = float(b);
+
+    if (IsRGBtoLabCubeEnabled()) { // use RGB to CIELab lookup cube
+        const float *cube = RGBtoLabCube(); // built on first use
+        for (int y = 0; y < source.rows; y++) { // parse image rows
+            const cv::Vec3b *color = source.ptr<cv::Vec3b>(y); // current source row (BGR)
+            cv::Vec3f *lab = temp.ptr<cv::Vec3f>(y); // current CIELab row
+            for (int x = 0; x < source.cols; x++) {
+                const float *values = cube + size_t((color[x][2] << 16) | (color[x][1] << 8) | color[x][0]) * 3; // CIELab values in cube
+                lab[x][0] = values[0]; // write CIELab values to temp image
+                lab[x][1] = values[1];
+                lab[x][2] = values[2];
+            }
         }
+        return temp;
+    }
+
+    std::vector<double> R(source.cols), G(source.cols), B(source.cols); // one row of values per channel for row kernels
+    std::vector<double> X(source.cols), Y(source.cols), Z(source.cols);
+    std::vector<double> L(source.cols), a(source.cols), b(source.cols);
+    for (int y = 0; y < source.rows; y++) { // parse image rows
+        const cv::Vec3b *color = source.ptr<cv::Vec3b>(y); // current source row (BGR)
+        for (int x = 0; x < source.cols; x++) { // split channels
+            R[x] = color[x][2] / 255.0;
+            G[x] = color[x][1] / 255.0;
+            B[x] = color[x][0] / 255.0;
+        }
+        RGBtoXYZRow(R.data(), G.data(), B.data(), X.data(), Y.data(), Z.data(), source.cols); // convert RGB to XYZ
+        XYZtoLABRow(X.data(), Y.data(), Z.data(), L.data(), a.data(), b.data(), source.cols); // convert XYZ to CIELab
+        cv::Vec3f *lab = temp.ptr<cv::Vec3f>(y); // current CIELab row
+        for (int x = 0; x < source.cols; x++) { // write CIELab values to temp image
+            lab[x][0] = float(L[x]);
+            lab[x][1] = float(a[x]);
+            lab[x][2] = float(b[x]);
+        }
+    }
 
     return temp;
 }
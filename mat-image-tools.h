@@ -19,11 +19,13 @@
 #-------------------------------------------------*/
 
 #ifndef MATIMAGETOOLS_H
-#define MATIMAGETOOLS
+#define MATIMAGETOOLS_H
 
 #include "opencv2/opencv.hpp"
 #include <opencv2/ximgproc.hpp>
+#ifdef QT_GUI_LIB // Qt conversions only when built with Qt GUI (not in headless library)
 #include <QImage>
+#endif
 
 enum shift_direction{shift_up=1, shift_right, shift_down, shift_left}; // directions for shift function
 enum gradientType {gradient_flat, gradient_linear, gradient_doubleLinear, gradient_radial}; // gradient types
@@ -33,6 +35,7 @@ enum anaglyphTint {tint_color, tint_gray, tint_true, tint_half, tint_optimized,
 
 //// Conversions between QImage, QPixmap & Mat
 ///
+#ifdef QT_GUI_LIB
 cv::Mat QImage2Mat(const QImage &source); // convert QImage to Mat
 cv::Mat QPixmap2Mat(const QPixmap &source); // convert QPixmap to Mat
 
@@ -40,6 +43,7 @@ QImage  Mat2QImage(const cv::Mat &source); // convert Mat to QImage
 QPixmap Mat2QPixmap(const cv::Mat &source); // convert Mat to QPixmap
 QPixmap Mat2QPixmapResized(const cv::Mat &source, const int &width, const int &height, const bool &smooth); // convert Mat to resized QPixmap
 QImage  cvMatToQImage(const cv::Mat &source); // another implementation Mat type wise
+#endif
 
 //// Brightness, Contrast, Gamma, Equalize, Balance
 
@@ -91,9 +95,16 @@ void GradientFillGray(const int &gradient_type, cv::Mat &img, const cv::Mat &msk
 
 cv::Mat AnaglyphTint(const cv::Mat & source, const int &tint); // change tint of image to avoid disturbing colors in red-cyan anaglyph mode
 
+//// Parallel processing
+
+int NbRowBands(const cv::Mat &image); // number of row bands for parallel processing of image - one per thread
+
 //// Number of colors in image
 
-int CountRGBUniqueValues(const cv::Mat &image); // count number of RGB colors in image
+int CountRGBUniqueValues(const cv::Mat &image); // count number of RGB colors in image (CV_8UC3) - bitmap, parallel over row bands
+int CountRGBUniqueValues(const cv::Mat &image, std::vector<int> &colors, std::vector<int> &counts); // same + sorted histogram : colors are (R << 16 | G << 8 | B) with their number of pixels
+int CountRGBValue(const std::vector<int> &colors, const std::vector<int> &counts, const int &R, const int &G, const int &B); // number of pixels of one RGB color in histogram from CountRGBUniqueValues - binary search
+void ReplaceRGBValues(cv::Mat &image, const std::vector<int> &from, const std::vector<int> &to); // replace colors (R << 16 | G << 8 | B) in image (CV_8UC3) in one pass - from must be sorted
 
 //// Conversion of images to other colors spaces
 
@@ -0,0 +1,197 @@
+/*#-------------------------------------------------
+#
+#       Stage timers and algorithm counters
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - scoped timers around each stage of a
+#     computation, nested stages allowed
+#   - algorithm counters (iterations, steps...)
+#   - export as Chrome trace-event JSON
+#     (chrome://tracing or ui.perfetto.dev)
+#   - no Qt dependency
+#
+#-------------------------------------------------*/
+
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <set>
+
+#include "profiler.h"
+
+thread_local struct_profile *active_profile = nullptr; // profile recording stages of this thread
+thread_local int active_depth = 0; // nesting level of next stage of this thread
+thread_local int thread_number = -1; // number of this thread in traces, -1 = not given yet
+std::atomic<int> next_thread_number(0); // next number to give
+
+int ProfileThread() // number of current thread, given on first use
+{
+    if (thread_number < 0)
+        thread_number = next_thread_number++;
+    return thread_number;
+}
+
+long long ProfileTime() // current time in microseconds (steady clock)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////
+//// Active profile and stages
+///////////////////////////////////////////////////////////
+
+ProfileActive::ProfileActive(struct_profile &profile) // record in this profile
+{
+    previous = active_profile;
+    active_profile = &profile;
+}
+
+ProfileActive::~ProfileActive() // stop recording
+{
+    active_profile = previous;
+}
+
+ProfileStage::ProfileStage(const std::string &name) // start a stage
+{
+    running = false;
+    Next(name);
+}
+
+ProfileStage::~ProfileStage() // end it if not already done
+{
+    Stop();
+}
+
+void ProfileStage::Next(const std::string &stage_name) // end this stage and start the next one
+{
+    Stop(); // end current stage, if any
+
+    profile = active_profile; // nothing recorded if no active profile
+    if (profile == nullptr)
+        return;
+    name = stage_name;
+    depth = active_depth++; // nested stages started after this one are one level deeper
+    running = true;
+    start = ProfileTime(); // last : don't measure this function
+}
+
+void ProfileStage::Stop() // end this stage now
+{
+    if (!running) // not recorded or already ended
+        return;
+
+    long long end = ProfileTime(); // first : don't measure this function
+    running = false;
+    active_depth--;
+    struct_profile_stage stage = {name, start, end - start, ProfileThread(), depth};
+    profile->stages.push_back(stage);
+}
+
+///////////////////////////////////////////////////////////
+//// Counters
+///////////////////////////////////////////////////////////
+
+void ProfileCount(const std::string &name, const long long &value) // add a value to a counter of active profile
+{
+    if (active_profile == nullptr) // not recording
+        return;
+
+    std::vector<struct_profile_counter> &counters = active_profile->counters;
+    for (unsigned int c = 0; c < counters.size(); c++) // few counters : linear search
+        if (counters[c].name == name) {
+            counters[c].value += value;
+            counters[c].time = ProfileTime();
+            return;
+        }
+    struct_profile_counter counter = {name, value, ProfileTime()}; // new counter
+    counters.push_back(counter);
+}
+
+void ProfileAppend(struct_profile &profile, const struct_profile &other) // append stages and counters of another profile
+{
+    profile.stages.insert(profile.stages.end(), other.stages.begin(), other.stages.end());
+    for (unsigned int c = 0; c < other.counters.size(); c++) { // counters with the same name are added
+        bool found = false;
+        for (unsigned int p = 0; p < profile.counters.size(); p++)
+            if (profile.counters[p].name == other.counters[c].name) {
+                profile.counters[p].value += other.counters[c].value;
+                profile.counters[p].time = std::max(profile.counters[p].time, other.counters[c].time);
+                found = true;
+                break;
+            }
+        if (!found)
+            profile.counters.push_back(other.counters[c]);
+    }
+}
+
+///////////////////////////////////////////////////////////
+//// Chrome trace-event export
+///////////////////////////////////////////////////////////
+
+std::string TraceString(const std::string &text) // text as JSON string - UTF-8 bytes are kept
+{
+    std::string json = "\"";
+    for (unsigned int i = 0; i < text.size(); i++) {
+        unsigned char c = text[i];
+        if ((c == '"') or (c == '\\')) // escape special chars
+            json += std::string("\\") + char(c);
+        else if (c < 32) { // control chars
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        }
+        else
+            json += char(c);
+    }
+    return json + "\"";
+}
+
+std::string ProfileTraceJSON(const struct_profile &profile) // stages as complete events "X", counters as counter events "C"
+{
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+    bool first = true; // first event : no comma
+    std::set<int> threads; // threads used, named in metadata events
+    for (unsigned int s = 0; s < profile.stages.size(); s++) {
+        const struct_profile_stage &stage = profile.stages[s];
+        json << (first ? "" : ",") << std::endl
+             << "  {\"name\": " << TraceString(stage.name) << ", \"cat\": \"stage\", \"ph\": \"X\", \"ts\": " << stage.start
+             << ", \"dur\": " << stage.duration << ", \"pid\": 1, \"tid\": " << stage.thread << "}";
+        threads.insert(stage.thread);
+        first = false;
+    }
+
+    for (unsigned int c = 0; c < profile.counters.size(); c++) {
+        const struct_profile_counter &counter = profile.counters[c];
+        json << (first ? "" : ",") << std::endl
+             << "  {\"name\": " << TraceString(counter.name) << ", \"cat\": \"counter\", \"ph\": \"C\", \"ts\": " << counter.time
+             << ", \"pid\": 1, \"args\": {\"value\": " << counter.value << "}}";
+        first = false;
+    }
+
+    for (std::set<int>::const_iterator t = threads.begin(); t != threads.end(); t++) {
+        json << (first ? "" : ",") << std::endl
+             << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << *t << ", \"args\": {\"name\": \"thread " << *t << "\"}}";
+        first = false;
+    }
+
+    json << std::endl << "]}" << std::endl;
+    return json.str();
+}
+
+bool SaveProfileTrace(const std::string &filename, const struct_profile &profile) // save Chrome trace-event JSON file
+{
+    std::ofstream save(filename);
+    if (!save)
+        return false;
+    save << ProfileTraceJSON(profile);
+    save.close();
+    return save.good();
+}
@@ -0,0 +1,71 @@
+/*#-------------------------------------------------
+#
+#       Stage timers and algorithm counters
+#
+#    by AbsurdePhoton - www.absurdephoton.fr
+#
+#                v1.0 - 2020/03/01
+#
+#   - scoped timers around each stage of a
+#     computation, nested stages allowed
+#   - algorithm counters (iterations, steps...)
+#   - export as Chrome trace-event JSON
+#     (chrome://tracing or ui.perfetto.dev)
+#   - no Qt dependency
+#
+#-------------------------------------------------*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+
+struct struct_profile_stage { // one timed stage
+    std::string name; // stage name
+    long long start; // start time in microseconds (steady clock)
+    long long duration; // duration in microseconds
+    int thread; // thread number, in order of first use
+    int depth; // nesting level : 0 = top stage
+};
+
+struct struct_profile_counter { // one algorithm counter
+    std::string name; // counter name
+    long long value; // total value
+    long long time; // time of last change in microseconds (steady clock)
+};
+
+struct struct_profile { // stages and counters of a computation
+    std::vector<struct_profile_stage> stages; // in order of end of stage
+    std::vector<struct_profile_counter> counters; // in order of first use
+};
+
+class ProfileActive { // while alive, stages and counters of this thread are recorded in a profile - nothing is recorded without it
+    public:
+        ProfileActive(struct_profile &profile); // record in this profile
+        ~ProfileActive(); // stop recording, previous active profile of this thread is restored
+    private:
+        struct_profile *previous; // active profile before this one
+};
+
+class ProfileStage { // scoped timer : one stage from construction to destruction, or Next and Stop
+    public:
+        ProfileStage(const std::string &name); // start a stage
+        ~ProfileStage(); // end it if not already done
+        void Next(const std::string &name); // end this stage and start the next one at the same level
+        void Stop(); // end this stage now
+    private:
+        struct_profile *profile; // profile active when stage started - nullptr = not recorded
+        std::string name; // stage name
+        long long start; // start time in microseconds
+        int depth; // nesting level
+        bool running; // not ended yet
+};
+
+long long ProfileTime(); // current time in microseconds (steady clock)
+void ProfileCount(const std::string &name, const long long &value); // add a value to a counter of active profile
+void ProfileAppend(struct_profile &profile, const struct_profile &other); // append stages and counters of another profile
+std::string ProfileTraceJSON(const struct_profile &profile); // stages and counters as Chrome trace-event JSON
+bool SaveProfileTrace(const std::string &filename, const struct_profile &profile); // save Chrome trace-event JSON file - returns false if not written
+
+#endif // PROFILER_H